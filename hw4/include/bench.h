@@ -0,0 +1,58 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * Search and evaluation benchmarks, run from the command line instead of a
+ * game.
+ *
+ * They use fixed sets of positions, reached from the initial position by
+ * seeded random walks over forward moves, so that results are comparable
+ * between runs and between builds.
+ */
+
+/**
+ * Measure the time each parallel search driver takes to reach a fixed depth
+ * with 1, 2, 4, ... threads, and print the speedup over one thread.  Each
+ * position is searched by iterative deepening from an empty hash table.
+ *
+ * @param d  The depth to which each position is searched.
+ * @param maxthreads  The largest number of threads tried.
+ */
+void bench_speedup(int d, int maxthreads);
+
+/**
+ * Search each benchmark position to a fixed depth, as bench_speedup() does
+ * but with the current driver and thread count only, and print the nodes
+ * searched and the time taken for each and in total.  With one thread the
+ * node counts are the same on every run and every machine, so a change to
+ * them shows that a change to the program changed what the search does,
+ * and the nodes per second compare the speed of builds.
+ *
+ * @param d  The depth to which each position is searched.
+ * @return  The total number of nodes searched.
+ */
+long bench_search(int d);
+
+/**
+ * Count the leaves of the move tree to a fixed depth from each benchmark
+ * position with generate_moves() on the library board and with
+ * bb_generate_moves() on bitboards, check that both generate the same set of
+ * moves at every node, and print the time each takes.
+ *
+ * @param d  The depth of the trees.
+ * @return 0 if the generators agree everywhere, -1 otherwise.
+ */
+int bench_movegen(int d);
+
+/**
+ * Check that the static evaluators (eval() in the library and evaluate())
+ * give the same score for each of a set of positions, and print the time
+ * each takes per call.  If a network has been loaded, its scores are timed
+ * and compared too, but a trained network is not expected to agree.
+ *
+ * @param rounds  The number of times each evaluator is run over the set.
+ * @return 0 if all the classic evaluators agree, -1 otherwise.
+ */
+int bench_eval(int rounds);
+
+#endif /* BENCH_H */
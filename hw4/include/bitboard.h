@@ -0,0 +1,154 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+
+#include "board.h"
+
+/*
+ * Bitboard representation of a position.
+ *
+ * The 81 cells of the playing area are numbered row * BOARD_SIZE + col and
+ * each player's pieces are one bit per cell of a 128-bit mask.  A step in one
+ * of the six directions is a shift of the whole mask by a fixed amount, after
+ * masking off the cells from which that step would leave the playing area
+ * (and so wrap onto another row or run past its ends).  Making or taking back a
+ * move is two or four bit flips, a copy is two words, and a player has won
+ * when its mask equals its goal triangle.
+ *
+ * The library's Board stays the position of record; a BitPosition is made
+ * from one with bb_from_board() and then follows the same moves.  The search
+ * does not use it: it makes and unmakes moves on the Board, whose running
+ * evaluation totals, hash key and move history it relies on.  A BitPosition
+ * serves where those are not needed: following book games past the length
+ * of the Board's move history (see book.c), and as a second move generator
+ * that perft and the -P bench check generate_moves() against.
+ */
+
+typedef unsigned __int128 Bitboard;
+
+#define BB_CELLS (BOARD_SIZE * BOARD_SIZE)
+#define BB_ALL ((((Bitboard)1) << BB_CELLS) - 1)
+#define BB_BIT(sq) (((Bitboard)1) << (sq))
+
+/* Cell number of a position encoded as (row << 4) | col, and back. */
+#define BB_SQUARE(pos) (((pos) >> 4) * BOARD_SIZE + ((pos) & 0xf))
+#define BB_POS(sq) ((((sq) / BOARD_SIZE) << 4) | ((sq) % BOARD_SIZE))
+
+typedef struct BitPosition {
+    Bitboard occ[2];                      // Cells holding each player's pieces
+    Player player;                        // Player to move
+} BitPosition;
+
+/* Cell number change of a step in each direction (rdirect[d] * BOARD_SIZE + cdirect[d]). */
+static const int bb_shift[6] = { 1, 1 - BOARD_SIZE, -BOARD_SIZE, -1, BOARD_SIZE - 1, BOARD_SIZE };
+
+extern Bitboard bb_from[6];               // Cells a step in each direction can start from
+extern Bitboard bb_goal[2];               // Each player's goal triangle
+extern Bitboard bb_swap[2];               // Cells on which each player may swap with an opponent
+
+/* Shift a set of cells by a cell number change, without masking. */
+static inline Bitboard bb_move(Bitboard b, int shift) {
+    return shift > 0 ? b << shift : b >> -shift;
+}
+
+/**
+ * Cells reached by a step in one direction from each cell of a set.  The
+ * directions are numbered as in rdirect[]/cdirect[].
+ *
+ * @param b  The set of cells.
+ * @param d  The direction, 0..5.
+ * @return  The set of cells one step away.
+ */
+static inline Bitboard bb_step(Bitboard b, int d) {
+    return bb_move(b & bb_from[d], bb_shift[d]);
+}
+
+/* Number of cells in a set, and the lowest-numbered one (the set must not be empty). */
+static inline int bb_count(Bitboard b) {
+    return __builtin_popcountll((uint64_t)b) + __builtin_popcountll((uint64_t)(b >> 64));
+}
+
+static inline int bb_first(Bitboard b) {
+    uint64_t lo = (uint64_t)b;
+    return lo ? __builtin_ctzll(lo) : 64 + __builtin_ctzll((uint64_t)(b >> 64));
+}
+
+/**
+ * Set up a bitboard position equal to a board.
+ *
+ * @param b  The position to be set up.
+ * @param bp  The board.
+ */
+void bb_from_board(BitPosition *b, Board *bp);
+
+/**
+ * Generate all legal moves for the player to move, the same moves as
+ * generate_moves() but in another order: the jumps piece by piece in cell
+ * order, then the steps direction by direction.  Every landing cell of a
+ * piece's jump chains is found in one flood fill over the masks rather than
+ * by following chains cell by cell, and the steps in one direction are found
+ * for all pieces at once.  It is no substitute for generate_moves() in the
+ * search, which needs the Board's order (move ordering was tuned on it); it
+ * is only modestly faster at -O2 and slower than generate_moves() at -O0.
+ *
+ * @param b  The position.
+ * @param list  The array that receives the moves (MAXPOSMOVES entries suffice).
+ * @return  The number of moves generated.
+ */
+int bb_generate_moves(const BitPosition *b, Move *list);
+
+/**
+ * Check whether a move is legal, as is_legal() does.
+ *
+ * @param b  The position.
+ * @param m  The move to be checked.
+ * @return  1 if the move is legal, 0 if not.
+ */
+int bb_is_legal(const BitPosition *b, Move m);
+
+/**
+ * Make a move, as apply() does.  The move must be legal.
+ *
+ * @param b  The position.
+ * @param m  The move.
+ */
+static inline void bb_apply(BitPosition *b, Move m) {
+    Player p = b->player;
+    Bitboard from = BB_BIT(BB_SQUARE((m >> 8) & 0xff)), to = BB_BIT(BB_SQUARE(m & 0xff));
+    if (b->occ[!p] & to)                  /* swap with an opponent piece */
+        b->occ[!p] ^= from | to;
+    b->occ[p] ^= from | to;
+    b->player = !p;
+}
+
+/**
+ * Take back the last move made, as undo() does.
+ *
+ * @param b  The position.
+ * @param m  The move, which must be the last one made.
+ */
+static inline void bb_undo(BitPosition *b, Move m) {
+    Player p = !b->player;
+    Bitboard from = BB_BIT(BB_SQUARE((m >> 8) & 0xff)), to = BB_BIT(BB_SQUARE(m & 0xff));
+    b->occ[p] ^= from | to;
+    if (b->occ[!p] & from)                /* the move was a swap */
+        b->occ[!p] ^= from | to;
+    b->player = p;
+}
+
+/**
+ * Determine whether the game is over, as game_over() does.
+ *
+ * @param b  The position.
+ * @return  1 if X has won, -1 if O has won, 0 otherwise.
+ */
+static inline int bb_game_over(const BitPosition *b) {
+    if (b->occ[X] == bb_goal[X])
+        return 1;
+    if (b->occ[O] == bb_goal[O])
+        return -1;
+    return 0;
+}
+
+#endif /* BITBOARD_H */
@@ -0,0 +1,63 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include "ccheck.h"
+
+/*
+ * Layout of the game board as implemented by board.o in lib/ccheck.a.
+ *
+ * ccheck.h treats Board as opaque, but the engine needs to look at cell
+ * contents (e.g. to hash positions), so the structure is spelled out here.
+ * It must be kept byte-for-byte identical to the library's definition.
+ *
+ * The playing area is a 9x9 rhombus addressed by (row, col) in 0..8, the same
+ * coordinates used in the Move encoding.  It is stored with a two-cell border
+ * of OFFBOARD cells so that neighbours of neighbours can be read unchecked.
+ * A cell holds either one of the special values below or a piece, encoded as
+ * (index << 3) | (player << 2), where index is the piece's slot in pos[].
+ *
+ * X starts in the corner where row + col <= 3 and heads for row + col >= 13;
+ * O does the reverse.  A single step may also land on an opponent piece that
+ * sits on a cell with row + col >= SWAP_X (for X) or <= SWAP_O (for O), so
+ * that a piece left behind cannot block the goal; the two pieces swap places.
+ */
+
+#define BOARD_SIZE 9                      // Rows and columns in the playing area
+#define BOARD_PAD 2                       // Width of the OFFBOARD border
+#define NPIECES 10                        // Pieces per player
+#define MAXHIST 200                       // Capacity of the move history
+#define WINPROGRESS 120                   // progress[] of a player with all pieces home
+#define SWAP_X 12                         // X may swap onto row + col >= SWAP_X
+#define SWAP_O 4                          // O may swap onto row + col <= SWAP_O
+
+/* Special cell values. */
+#define OFFBOARD 1                        // Outside the playing area
+#define VISITED 2                         // Transient mark used by the jump generator
+#define EMPTY 3                           // Empty cell
+
+struct board {
+    int cell[BOARD_SIZE + 2 * BOARD_PAD][BOARD_SIZE + 2 * BOARD_PAD];
+    Move history[MAXHIST];                // Moves applied, for undo()
+    int nhist;                            // Number of entries in history
+    Player player;                        // Player to move
+    int progress[2];                      // Sum of row + col advanced toward the goal
+    int center[2];                        // Centre-line bonus: 32 - sum of |row - col|
+    int movenum;                          // Move number (not decremented by undo())
+    int pos[2][NPIECES];                  // Piece positions, as (row << 4) | col
+};
+
+_Static_assert(sizeof(struct board) == 0x630, "struct board must match board.o");
+
+/* Cell contents, by playing-area coordinates. */
+#define CELL(bp, r, c) ((bp)->cell[(r) + BOARD_PAD][(c) + BOARD_PAD])
+
+/* Whether a cell value is a piece rather than one of the special values. */
+#define IS_PIECE(v) ((unsigned)(v) - 1 > 2)
+#define PIECE_PLAYER(v) (((v) >> 2) & 1)
+#define PIECE_INDEX(v) (((v) >> 3) & 0xf)
+
+/* Position encoding shared by pos[] and the Move nibbles. */
+#define POS_ROW(x) (((x) >> 4) & 0xf)
+#define POS_COL(x) ((x) & 0xf)
+
+#endif /* BOARD_H */
@@ -0,0 +1,54 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include "ccheck.h"
+
+/*
+ * Opening book.
+ *
+ * Every game starts from the same position, so the first moves need not be
+ * searched for.  The book is a file of (position key, move, weight) entries
+ * sorted by key, built from the transcripts of earlier games (written with
+ * -o, including self-play games between two engines).  Keys are those of
+ * tt_board_key(), so a position is found however it was reached.  The engine
+ * maps the file into memory and looks the position up before searching.
+ */
+
+#define BOOK_PLY 20                       // Ply of each game recorded in the book
+
+extern const char *book_path;             // Book file to use (-k), or NULL
+
+/**
+ * Build a book from game transcripts and write it to a file.  Each move
+ * played in the first BOOK_PLY ply of a game is weighted by the outcome of
+ * the game for the player who made it: 2 for a win, 1 for a game that did not
+ * finish, 0 for a loss.  Moves with no weight are left out.
+ *
+ * @param path  The name of the file to be written.
+ * @param transcripts  The names of the transcript files.
+ * @param n  The number of transcript files.
+ * @return 0 on success, -1 if a transcript could not be read or the book
+ * could not be written.
+ */
+int book_build(const char *path, char *transcripts[], int n);
+
+/**
+ * Map a book file into memory for book_move() to use.
+ *
+ * @param path  The name of the file written by book_build().
+ * @return 0 on success, -1 if the file could not be opened or is not a book.
+ */
+int book_open(const char *path);
+
+/**
+ * Look up a move for the player to move.  With randomized play a move is
+ * chosen at random in proportion to its weight, otherwise the move with the
+ * greatest weight is returned.
+ *
+ * @param bp  The board.
+ * @return  A legal move from the book, or 0 if no book is open or the
+ * position is not in it.
+ */
+Move book_move(Board *bp);
+
+#endif /* BOOK_H */
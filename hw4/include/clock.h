@@ -0,0 +1,187 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+#include "ccheck.h"
+
+/*
+ * Time accounting in microseconds on the monotonic clock.
+ *
+ * The library keeps the time control in stats.o in whole seconds read from
+ * time(): avgtime, movetime, xtime, otime and the times[] estimates.  That
+ * cannot budget games of a second or less a move, and time() jumps when the
+ * system clock is set.  This module keeps the same accounts at microsecond
+ * resolution: clock_charge() takes the place of setclock(), and still calls
+ * it, so the library's totals printed by print_stats() are kept as before.
+ * In place of times[] and timings(), whose estimates start in whole seconds
+ * and take many moves to come down to a bullet game's, the time of the next
+ * iteration is estimated from the last one's (clock_estimate()).
+ *
+ * A game is played under one of three time controls.  By default each move
+ * is allowed clock_avg on average (-a), as with avgtime.  With a game clock
+ * (-c), each player starts with clock_base, gains clock_inc after each move,
+ * and, if clock_mtg is set, gains clock_base again after every clock_mtg
+ * moves; a player whose clock runs out loses.  With clock_fixed (-f), every
+ * move is given that time and no more.  The engine is a child of the process
+ * that sets these from the options, so it sees the same settings.
+ *
+ * The time for a move is shared out by clock_limits() as a soft limit, past
+ * which iterative deepening starts no new iteration, and a hard limit, the
+ * search's deadline.  Between them, clock_continue() stops sooner when the
+ * best move has settled and goes on longer when the score is falling.
+ */
+
+#define USEC_PER_SEC 1000000
+#define CLOCK_DEFAULT_AVG (5 * USEC_PER_SEC)    // Average time per move when -a is not given
+#define CLOCK_GAME_PLY 120                // Expected length of a game, for the number of moves left
+#define CLOCK_MIN_MOVES 8                 // Least number of moves the time left is shared among
+#define CLOCK_HARD_FACTOR 4               // Hard limit as a multiple of the soft limit
+#define CLOCK_RESERVE 10                  // The hard limit leaves 1/CLOCK_RESERVE of the time left
+#define CLOCK_OVERHEAD (USEC_PER_SEC / 50)  // Time set aside per move for passing it between processes
+#define CLOCK_STABLE_ITERS 3              // Iterations with the same best move that halve the soft limit
+#define CLOCK_PANIC_DROP 30               // Fall in score that doubles the soft limit
+#define CLOCK_BRANCHING 4.0               // Ratio of an iteration's time to the last one's, until measured
+#define CLOCK_MIN_SAMPLE 1000             // Shortest iteration whose time is used to measure that ratio
+
+/* Limits on the time spent searching for one move, from the start of the search. */
+typedef struct TimeLimits {
+    int64_t soft;                         // Start no iteration past this (see clock_continue())
+    int64_t hard;                         // Stop the search here
+} TimeLimits;
+
+extern int64_t clock_avg;                 // Average time allowed per move (-a), 0 for the default
+extern int64_t clock_base;                // Time on each player's clock at the start (-c), 0 for none
+extern int64_t clock_inc;                 // Time added to the mover's clock after each move (-g)
+extern int clock_mtg;                     // Moves in each period of clock_base (-m), 0 for sudden death
+extern int64_t clock_fixed;               // Time for every move (-f), 0 for none; overrides the others
+extern int64_t clock_used[2];             // Total time used by each player
+extern int64_t clock_moved;               // clock_now() when a player was last charged
+extern int64_t clock_searched;            // clock_now() when the last search began
+extern int64_t clock_iter[];              // Time taken by the last iteration to each depth (0..MAXPLY)
+extern double clock_branching;            // Ratio of an iteration's time to the last one's
+
+/**
+ * Read the monotonic clock.
+ *
+ * @return  The time in microseconds since an arbitrary starting point.
+ */
+int64_t clock_now(void);
+
+/**
+ * Parse a time given on the command line: a number of seconds, which may
+ * have a fraction and an "s" suffix ("2", "0.5", "1.5s"), or a number of
+ * milliseconds with an "ms" suffix ("250ms").
+ *
+ * @param s  The string to parse.
+ * @return  The time in microseconds, or -1 if s is not a time (or is not
+ * finite, or too large to count in microseconds).
+ */
+int64_t clock_parse(const char *s);
+
+/**
+ * Start the clocks of a game: neither player has used any time, and the
+ * time of the last move is now (for setclock() too).
+ *
+ * @param ply  The number of ply played before the clocks start (moves
+ * loaded with -i are not timed).
+ */
+void clock_reset(int ply);
+
+/**
+ * Charge a player for the time since the last call (or clock_reset()), as
+ * setclock() does, and call setclock() as well.
+ *
+ * @param p  The player to be charged, which should be the player from whom
+ * a move has been received but not yet applied to the board.
+ */
+void clock_charge(Player p);
+
+/**
+ * The time left on a player's game clock before its move at a ply: the
+ * time of each period begun and the increments of its earlier moves, less
+ * the time it has used.  Meaningful only if clock_base is set.
+ *
+ * @param p  The player.
+ * @param ply  The ply of the player's move (move_number()).
+ * @return  The time left, negative if the player has run out of time.
+ */
+int64_t clock_left(Player p, int ply);
+
+/**
+ * The number of moves a player has to make, this one included, before
+ * clock_base is next added to its clock.
+ *
+ * @param p  The player.
+ * @param ply  The ply of the player's move (move_number()).
+ * @return  The number of moves, or 0 under sudden death (clock_mtg not set).
+ */
+int clock_movestogo(Player p, int ply);
+
+/**
+ * Note the start of an iteration, for clock_timings().
+ */
+void clock_start(void);
+
+/**
+ * Note the time since clock_start() as the time of the iteration to depth
+ * d.  If the iteration to depth d - 1 took at least CLOCK_MIN_SAMPLE (those
+ * shorter are mostly overhead), the ratio of the two times is averaged into
+ * clock_branching, with a weight of one quarter.
+ *
+ * @param d  The depth of the iteration just completed.
+ */
+void clock_timings(int d);
+
+/**
+ * Estimate the time of the iteration to depth d + 1: the time the
+ * iteration to depth d took, times clock_branching.
+ *
+ * @param d  The depth of the iteration just completed (by clock_timings()).
+ * @return  The estimated time.
+ */
+int64_t clock_estimate(int d);
+
+/**
+ * Share out the time left among the moves left, and weight the share by the
+ * phase of the game: less in the opening, which is quiet or in the book, and
+ * in the race to the goal at the end, and more in the middle game, where
+ * the best move and its score change most from one iteration to the next.
+ * The hard limit is CLOCK_HARD_FACTOR times the soft limit, but never more
+ * than the time left less a reserve, nor, on a game clock (clock_base), more
+ * than half the time left while other moves must share it.  (An average
+ * time per move is not shared that way: each later move brings its own.)
+ * CLOCK_OVERHEAD is set aside for each move, and kept back from the hard
+ * limit, for the time a move spends between the engine and the clock that
+ * charges it (pipes, the parent process, and whatever relays moves to and
+ * from another program).
+ *
+ * @param left  The time left on the mover's clock, including this move's.
+ * @param inc  The time each later move adds to the clock.
+ * @param movestogo  The number of moves (this one included) until the clock
+ * is next replenished, or 0 if it is not, in which case it is estimated
+ * from the ply and CLOCK_GAME_PLY.
+ * @param ply  The number of ply played so far (move_number()).
+ * @param tl  Receives the limits.
+ */
+void clock_limits(int64_t left, int64_t inc, int movestogo, int ply, TimeLimits *tl);
+
+/**
+ * Decide whether iterative deepening should start another iteration.  It
+ * should not once the soft limit has passed, or if the estimated time of
+ * the iteration would take it past the hard limit.  The soft limit is
+ * halved when the best move has been the same for CLOCK_STABLE_ITERS
+ * iterations, and doubled (up to the hard limit) when the score has fallen
+ * by CLOCK_PANIC_DROP or more.
+ *
+ * @param tl  The limits for the move.
+ * @param elapsed  The time since the search for the move began.
+ * @param estimate  The estimated time of the next iteration.
+ * @param stable  The number of iterations in a row that chose the best move.
+ * @param drop  How far the score has fallen since the last iteration of the
+ * same parity (scores alternate between odd and even depths).
+ * @return  Non-zero if another iteration should be started.
+ */
+int clock_continue(const TimeLimits *tl, int64_t elapsed, int64_t estimate, int stable, int drop);
+
+#endif /* CLOCK_H */
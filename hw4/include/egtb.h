@@ -0,0 +1,62 @@
+#ifndef EGTB_H
+#define EGTB_H
+
+#include "ccheck.h"
+
+/*
+ * Endgame tablebase for the race home.
+ *
+ * Once all of a player's pieces are on cells within EGTB_LINE diagonals of
+ * its goal corner (row + col >= 16 - EGTB_LINE + 1 for X, the mirror image
+ * for O) and no opponent piece is on those or the next two diagonals, the
+ * opponent can no longer block a move or offer a piece to jump over: the
+ * pieces only need to be brought home.  The tablebase gives, for every placement of the ten pieces within
+ * that region, the least number of moves that does it, found by retrograde
+ * analysis (breadth-first search backward from the filled home).  When both
+ * players are in such a position the outcome of the game is known exactly.
+ *
+ * Moves that end outside the region are not considered (a jump chain may
+ * pass through the diagonal next to it), so a distance is the best that can
+ * be done while staying inside it.  One table serves both players,
+ * since the board is symmetric under (row, col) -> (8 - row, 8 - col).
+ *
+ * The file holds a header followed by one byte per placement, indexed by the
+ * combinatorial number system over the region's cells, and is mapped into
+ * memory rather than read.
+ */
+
+#define EGTB_LINE 7                       // Diagonals (row + col values) covered, counted from the goal corner
+#define EGTB_UNKNOWN 255                  // Distance of a placement from which home cannot be reached
+
+extern const char *egtb_path;             // Tablebase file to use (-e), or NULL
+
+/**
+ * Build the tablebase and write it to a file.
+ *
+ * @param path  The name of the file to be written.
+ * @param nthreads  The number of threads to use.
+ * @return 0 on success, -1 if the file could not be written.
+ */
+int egtb_generate(const char *path, int nthreads);
+
+/**
+ * Map a tablebase file into memory for egtb_distance() to use.
+ *
+ * @param path  The name of the file written by egtb_generate().
+ * @return 0 on success, -1 if the file could not be opened or is not a
+ * tablebase built with the same parameters.
+ */
+int egtb_open(const char *path);
+
+/**
+ * Look up the number of moves a player needs to bring all its pieces home.
+ * Safe to call from any number of threads.
+ *
+ * @param bp  The board.
+ * @param p  The player.
+ * @return  The number of moves, or -1 if no tablebase is open, the position
+ * is not covered by it, or home cannot be reached without leaving the region.
+ */
+int egtb_distance(Board *bp, Player p);
+
+#endif /* EGTB_H */
@@ -0,0 +1,84 @@
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "board.h"
+
+/*
+ * Reentrant move generation and evaluation.
+ *
+ * moves() and eval() in the library report through the process-global
+ * resultlist/resultp and nodes, so only one search can use them at a time.
+ * These functions produce the same results but write only into the board
+ * and the list they are given, so independent boards can be searched
+ * concurrently.
+ */
+
+/*
+ * Most moves generate_moves() can list in one position: a piece has at most
+ * one jump to each empty cell (each is listed once) and at most six steps.
+ */
+#define MAXPOSMOVES (NPIECES * (BOARD_SIZE * BOARD_SIZE - 2 * NPIECES + 6))
+
+/**
+ * Generate all legal moves for the player to move: for each piece in turn,
+ * its jump moves followed by its single steps, as moves() does.  A landing
+ * cell reached by several chains of hops gives one move, as in moves().
+ *
+ * The board is used as scratch space while jump chains are followed, but is
+ * left unchanged on return.
+ *
+ * @param bp  The board for which moves are to be generated.
+ * @param list  The array that receives the moves (MAXPOSMOVES entries suffice).
+ * @param hops  If not NULL, incremented by the number of hops that reached an
+ * already listed landing cell and were not followed further (no move is
+ * lost: the cell's move is already listed).
+ * @return  The number of moves generated.
+ */
+int generate_moves(Board *bp, Move *list, long *hops);
+
+/**
+ * Generate only the jump moves for the player to move, in the same order as
+ * generate_moves() lists them.
+ *
+ * @param bp  The board for which moves are to be generated.
+ * @param list  The array that receives the moves (MAXPOSMOVES entries suffice).
+ * @param hops  If not NULL, incremented as by generate_moves().
+ * @return  The number of moves generated.
+ */
+int generate_jumps(Board *bp, Move *list, long *hops);
+
+/**
+ * Check whether a move is legal, as legal_move() does but without touching
+ * any global state: whether it is among the moves generate_moves() lists.
+ * Used to check moves from the transposition table and the book, which may
+ * belong to another position with the same key.
+ *
+ * @param bp  The board against which the move is to be checked.
+ * @param m  The move to be checked.
+ * @return  1 if the move is legal, 0 if not.
+ */
+int is_legal(Board *bp, Move m);
+
+/**
+ * Make room in a board's move history for more moves.  apply() records each
+ * move in the history without checking its capacity (MAXHIST), so a long
+ * game, or a search on top of one, would run past its end.  If fewer than n
+ * entries are free, the oldest moves are dropped until n are; undo() can
+ * then take back only the moves still recorded.
+ *
+ * @param bp  The board.
+ * @param n  The number of moves that must fit (less than MAXHIST).
+ */
+void make_history_room(Board *bp, int n);
+
+/**
+ * Static evaluation, identical to eval() in the library but without
+ * touching any global state.
+ *
+ * @param bp  The board to be evaluated.
+ * @param p  The player from whose point of view the score is given.
+ * @return  The score, or +/-(MAXEVAL - 1) if the game has been won.
+ */
+int evaluate(Board *bp, Player p);
+
+#endif /* MOVEGEN_H */
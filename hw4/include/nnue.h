@@ -0,0 +1,94 @@
+#ifndef NNUE_H
+#define NNUE_H
+
+#include <stdint.h>
+
+#include "ccheck.h"
+
+/*
+ * Efficiently updatable neural network evaluation (optional, -n).
+ *
+ * The inputs are one per player and cell, set when the player has a piece
+ * there.  The first layer's outputs, the accumulator, are kept by the search
+ * for its board and changed by the two or four columns of weights a move
+ * touches, instead of being recomputed.  Two small quantized layers follow:
+ *
+ *   acc (int16, NNUE_H1) -> clamp 0..127 -> int8 weights -> (>> NNUE_SHIFT)
+ *   -> clamp 0..127 (NNUE_H2) -> int8 weights -> score, from X's view
+ *
+ * The second layer runs as SIMD byte dot products when the CPU has AVX2.
+ * The weights are read from a file; nnue_write_default() writes a network
+ * that reproduces the classic evaluation exactly, as a starting point for
+ * training and a check of the whole pipeline.  The network takes the place
+ * of evaluate() only: the search adds its straggler penalties (see
+ * straggler_weight) to the network's score as it does to evaluate()'s.
+ */
+
+#define NNUE_INPUTS (2 * 81)              // One per player and cell
+#define NNUE_H1 64                        // Width of the accumulator
+#define NNUE_H2 16                        // Width of the second layer
+#define NNUE_SHIFT 6                      // Right shift applied to the second layer's sums
+
+typedef struct NnueAcc {
+    int16_t v[NNUE_H1];
+} __attribute__((aligned(32))) NnueAcc;
+
+extern const char *nnue_path;             // Weights file to use (-n), or NULL
+extern int nnue_ready;                    // Set once a weights file has been loaded
+
+/**
+ * Load the network weights from a file.
+ *
+ * @param path  The name of the weights file.
+ * @return 0 on success, -1 if the file could not be read or does not have
+ * the layer sizes this program was built with.
+ */
+int nnue_open(const char *path);
+
+/**
+ * Write the weights of a network that computes the classic evaluation.
+ *
+ * @param path  The name of the file to be written.
+ * @return 0 on success, -1 if the file could not be written.
+ */
+int nnue_write_default(const char *path);
+
+/**
+ * Compute the accumulator for a board from scratch.
+ *
+ * @param a  The accumulator.
+ * @param bp  The board.
+ */
+void nnue_reset(NnueAcc *a, Board *bp);
+
+/**
+ * Add (sign 1) or take back (sign -1) the change a move makes to the
+ * accumulator.
+ *
+ * @param a  The accumulator.
+ * @param bp  The board, in the position before the move.
+ * @param m  The move.
+ * @param sign  1 when the move is made, -1 when it is taken back.
+ */
+void nnue_move(NnueAcc *a, Board *bp, Move m, int sign);
+
+/**
+ * Run the layers after the accumulator.  Wins are not detected here.
+ *
+ * @param a  The accumulator for the position.
+ * @param p  The player from whose point of view the score is given.
+ * @return  The score.
+ */
+int nnue_evaluate(const NnueAcc *a, Player p);
+
+/**
+ * Static evaluation by the network from scratch, with wins scored as
+ * evaluate() scores them; for benchmarks and tests.
+ *
+ * @param bp  The board to be evaluated.
+ * @param p  The player from whose point of view the score is given.
+ * @return  The score.
+ */
+int nnue_evaluate_full(Board *bp, Player p);
+
+#endif /* NNUE_H */
@@ -0,0 +1,158 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdint.h>
+
+#include "ccheck.h"
+
+/* Library internals that are not declared in ccheck.h. */
+extern Move resultlist[];                 // Output of the move generators (move.o)
+extern Move *resultp;                     // One past the last generated move
+extern int nodes;                         // Nodes evaluated since reset_stats()
+void moves(Board *bp);                    // Generate all moves for the player to move
+void jump_moves(Board *bp);               // Generate only the jump moves
+void step_moves(Board *bp);               // Generate only the single-step moves
+int eval(Board *bp, Player p);            // Static evaluation from p's point of view
+
+/**
+ * Take back the last move applied to a board (board.o).  apply() records
+ * each move in the board's history; undo() removes it and restores the
+ * cells, piece positions, progress and centre totals and player to move,
+ * so a search can make and take back moves on one board instead of copying
+ * it.  Only the move number is left as it is.  The history holds MAXHIST
+ * moves (see board.h), so no more than that can be taken back.
+ *
+ * @param bp  The board, which must have had a move applied.
+ */
+void undo(Board *bp);
+
+#define MAXMOVES 1000                     // Capacity of resultlist
+#define WINEVAL (MAXEVAL - 1)             // Static evaluation of a won position
+#define MINWIN (WINEVAL - 1000)           // Scores beyond +/-MINWIN are forced wins or losses
+                                          // (within MAXPLY ply, or further off by the tablebase)
+#define QUIESCE_PLY 4                     // Default for quiesce_ply
+#define STACK_PLY (2 * MAXPLY)            // Most moves a search makes on its board: MAXPLY, then quiescence
+#define LMR_BASE 0.5                      // Default for lmr_base
+#define LMR_DIVISOR 2.0                   // Default for lmr_divisor
+#define STRAGGLER_WEIGHT 4                // Default for straggler_weight
+#define MAXTHREADS 64                     // Upper limit on search_threads
+#define STOP_CHECK_NODES 256              // Nodes a thread visits between looks at the clock (a power of 2)
+
+/* Ways of using more than one search thread (search_driver). */
+#define SEARCH_LAZY 0                     // Lazy SMP: threads share only the hash table
+#define SEARCH_YBWC 1                     // Young Brothers Wait: threads split the tree
+
+extern uint64_t search_key;               // Zobrist key of the current position
+extern int search_threads;                // Number of search threads (-j)
+extern int search_driver;                 // SEARCH_LAZY or SEARCH_YBWC (-y)
+extern int search_stop;                   // Set (atomically) to stop the search in progress
+extern int64_t search_deadline;           // clock_now() time at which the search sets search_stop, 0 for none
+extern long search_node_limit;            // Value of "nodes" at which the main thread sets search_stop, 0 for none
+extern int search_fixed_depth;            // Depth of every engine search (-D), 0 to go by the clock
+extern long search_fixed_nodes;           // Nodes of every engine search (-L), 0 to go by the clock
+extern int quiesce_ply;                   // Ply of forward jumps searched past the depth cutoff
+extern double lmr_base;                   // Late move reductions: constant term (-R)
+extern double lmr_divisor;                // Late move reductions: divisor, 0 for none (-R)
+extern int straggler_weight;              // Penalty, in 1/16ths, per square of a piece's distance from home
+
+/**
+ * Prepare the search for a new game position.  The transposition table is
+ * allocated with the size given by "hash_mb" and the position key is reset,
+ * so every position reached afterwards is keyed relative to the board passed
+ * to the engine.  The table of late move reductions is computed here from
+ * "lmr_base" and "lmr_divisor": a late move at a node with d ply left is
+ * searched lmr_base + ln(d) * ln(n) / lmr_divisor ply less deep, where n is
+ * the number of moves searched before it.  Likewise the straggler penalties
+ * added to the static evaluation are computed from "straggler_weight".
+ */
+void search_init(void);
+
+/**
+ * Apply a move to the board, keeping "search_key" up to date.  Every move
+ * applied to the engine's board must go through this function (or be
+ * reverted with search_undo) for the transposition table to remain valid.
+ * The board's history is first trimmed so that a search still has room for
+ * its moves after this one (see make_history_room() in movegen.h).
+ *
+ * @param bp  The board to which the move is to be applied.
+ * @param m  The move to apply.
+ */
+void search_apply(Board *bp, Move m);
+
+/**
+ * Take back the last move applied with search_apply.
+ *
+ * @param bp  The board from which the move is to be taken back.
+ * @param m  The move that was applied.
+ */
+void search_undo(Board *bp, Move m);
+
+/**
+ * Reset the statistics kept by search(), as reset_stats() does
+ * for the library's statistics.
+ */
+void reset_search_stats(void);
+
+/**
+ * Print the statistics kept by search() on stderr: the number
+ * of nodes that failed high, the percentage of those in which it was the
+ * first move searched that failed high, and the number of aspiration windows
+ * (see search_aspiration) that had to be widened.
+ */
+void print_search_stats(void);
+
+/**
+ * Search the game tree to the depth cutoff given by the "depth" global, using
+ * negamax alpha/beta with a transposition table, and with helper threads if
+ * "search_threads" is greater than 1 (used as selected by "search_driver").
+ * This plays the same role as bestmove() in the library: on return
+ * pv[0..depth-1] holds the principal variation, so pv[0] is the best move
+ * found for the side to move.
+ * On entry, pv may hold the principal variation of a shallower search of the
+ * same position (terminated by a 0 move, or all zeros if there is none); its
+ * moves are searched first along its path, as in iterative deepening.
+ * The number of nodes searched, summed over all threads, is added to "nodes".
+ * The search makes and takes back up to STACK_PLY moves on bp, or on a copy
+ * of it if bp's history has no room for them (see make_history_room()).
+ *
+ * The search uses no library state other than "depth" and "nodes", and only
+ * reads "search_key", so it may run on a thread of its own while the caller
+ * works with other boards.  Setting "search_stop" makes it return promptly;
+ * the score and PV of a stopped search are meaningless.  Every thread looks at
+ * the clock once in STOP_CHECK_NODES nodes and sets "search_stop" itself once
+ * "search_deadline" (if not 0) has passed, so a search can be given a time
+ * limit without another thread to watch it.  Likewise the main thread sets
+ * "search_stop" once "nodes" plus the nodes it has searched reaches
+ * "search_node_limit" (if not 0).  It checks at every node, so with one
+ * thread the search stops after the same number of nodes on every run.
+ *
+ * @param bp  The starting board position for the search.
+ * @param p  The player whose turn it is to move in the specified position.
+ * @param pv  The array that receives the principal variation.
+ * @param alpha  The alpha cutoff threshold (in range [-MAXEVAL, MAXEVAL]).
+ * @param beta  The beta cutoff threshold (in range [-MAXEVAL, MAXEVAL]).
+ * @return  The score of the position from the point of view of p.  Unlike
+ * bestmove(), the score is not negated.  A won position scores WINEVAL
+ * less the number of ply needed to win, so that faster wins are preferred.
+ * Positions at the depth cutoff are not simply evaluated: forward jumps are
+ * followed for up to "quiesce_ply" further ply (see search.c).
+ */
+int search(Board *bp, Player p, Move pv[], int alpha, int beta);
+
+/**
+ * Search as search() does, but start with a narrow aspiration window around
+ * an estimate of the score, widening it on the side that fails until the
+ * score falls inside.  In iterative deepening the estimate should be the
+ * score of the search two ply shallower: scores alternate between odd and
+ * even depths, since the side to move at the horizon has the advantage.
+ *
+ * @param bp  The starting board position for the search.
+ * @param p  The player whose turn it is to move in the specified position.
+ * @param pv  As for search().
+ * @param guess  The expected score, or MAXEVAL if there is no estimate (in
+ * which case the full window is searched).
+ * @return  The score of the position from the point of view of p.
+ */
+int search_aspiration(Board *bp, Player p, Move pv[], int guess);
+
+#endif /* SEARCH_H */
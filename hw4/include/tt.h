@@ -0,0 +1,97 @@
+#ifndef TT_H
+#define TT_H
+
+#include <stdint.h>
+
+#include "ccheck.h"
+
+/*
+ * Transposition table keyed by a 64-bit Zobrist hash of the position.
+ *
+ * The hash is maintained incrementally from the moves applied to the board:
+ * a move by player p from cell a to cell b changes the key by
+ * zobrist[p][a] ^ zobrist[p][b] ^ side (plus the opponent's keys for the two
+ * cells if the move swaps pieces).  The key of a position is therefore
+ * defined relative to the position the engine started from, which is all
+ * that is needed since every position searched is reached from there.
+ *
+ * The table is shared by all search threads without locking.  Each slot
+ * holds the packed entry and the key XORed with it; a slot torn by two
+ * concurrent writers fails the key check on probe and reads as a miss.
+ */
+
+#define TT_DEFAULT_MB 16                  // Table size used when -H is not given
+
+/* Bound types stored with a score. */
+#define TT_EXACT 0                        // Score is exact
+#define TT_LOWER 1                        // Score is a lower bound (fail high)
+#define TT_UPPER 2                        // Score is an upper bound (fail low)
+
+/* An entry as returned by tt_probe (slots store it packed into 64 bits). */
+typedef struct TTEntry {
+    int32_t score;                        // Score from the side to move's view
+    Move move;                            // Best move found (0 if none)
+    uint8_t depth;                        // Remaining depth of the search, in ply
+    uint8_t bound;                        // TT_EXACT, TT_LOWER or TT_UPPER
+} TTEntry;
+
+extern int hash_mb;                       // Requested table size in megabytes (-H)
+
+/**
+ * Allocate the table and the Zobrist keys.  The number of entries is the
+ * largest power of two that fits in the specified size.  Calling this again
+ * discards the previous table.
+ *
+ * @param mb  The size of the table in megabytes (at least 1 is used).
+ * @return 0 on success, -1 if the table could not be allocated.
+ */
+int tt_init(int mb);
+
+/**
+ * Forget every stored position, keeping the allocation.
+ */
+void tt_clear(void);
+
+/**
+ * Compute the change to the Zobrist key caused by a move.
+ *
+ * @param bp  The board in the position before the move.
+ * @param m  The move.  A null move (from == to) only flips the side to move.
+ * @return  The value to XOR into the key of the position before the move.
+ */
+uint64_t tt_move_key(Board *bp, Move m);
+
+/**
+ * Compute the key of a position from scratch.  It differs from the key
+ * maintained by tt_move_key() by a constant (the key of the starting
+ * position), so it identifies the same position in every game.
+ *
+ * @param bp  The board.
+ * @return  The key: the XOR of the keys of the occupied cells, and of the
+ * side key if O is to move.
+ */
+uint64_t tt_board_key(Board *bp);
+
+/**
+ * Look up a position.
+ *
+ * @param key  The Zobrist key of the position.
+ * @param e  Receives the entry stored for the position, if there is one.
+ * @return  1 if an entry was found, 0 if not.
+ */
+int tt_probe(uint64_t key, TTEntry *e);
+
+/**
+ * Record the result of searching a position.  An existing entry for the same
+ * position is only replaced by a search at least as deep; entries for other
+ * positions sharing the slot are always replaced.
+ *
+ * @param key  The Zobrist key of the position.
+ * @param d  The remaining depth, in ply, that was searched.
+ * @param bound  TT_EXACT, TT_LOWER or TT_UPPER.
+ * @param score  The score, with win scores already made ply-independent.
+ * @param m  The best move found, or 0.
+ */
+void tt_store(uint64_t key, int d, int bound, int score, Move m);
+
+#endif /* TT_H */
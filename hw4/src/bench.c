@@ -0,0 +1,315 @@
+/*
+ * Search benchmarks.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "bitboard.h"
+#include "board.h"
+#include "ccheck.h"
+#include "clock.h"
+#include "movegen.h"
+#include "nnue.h"
+#include "search.h"
+#include "tt.h"
+
+#define BENCH_POSITIONS 8                 // Number of positions searched
+#define BENCH_SPACING 6                   // Ply between successive positions
+#define BENCH_SEED 20240601u              // Seed of the random walk
+#define EVAL_POSITIONS 1024               // Number of positions evaluated
+#define EVAL_MAXPLY 150                   // Longest walk to an evaluated position
+
+static const char *driver_names[] = { "lazy", "ybwc" };
+
+static int cmp_move(const void *a, const void *b) {
+    return *(const Move *)a - *(const Move *)b;
+}
+
+/* Whether a move takes its piece nearer the mover's goal corner. */
+static int forward(Move m, Player p) {
+    int d = (row_to(m) + col_to(m)) - (row_from(m) + col_from(m));
+    return p == X ? d > 0 : d < 0;
+}
+
+/*
+ * Play n ply from the initial position, each a forward move chosen at random
+ * from the given seed.  If sorted, moves are sorted before choosing, so the
+ * position does not depend on the order in which moves are generated.
+ */
+static void bench_position(Board *bp, int n, unsigned seed, int sorted) {
+    Move list[MAXPOSMOVES];
+    for (int ply = 0; ply < n && !game_over(bp); ply++) {
+        int nm = generate_moves(bp, list, NULL);
+        if (sorted)
+            qsort(list, nm, sizeof(Move), cmp_move);
+        int nf = 0;
+        for (int i = 0; i < nm; i++)
+            if (forward(list[i], bp->player))
+                list[nf++] = list[i];
+        if (nf == 0)
+            nf = nm;
+        seed = seed * 1103515245 + 12345;
+        apply(bp, list[(seed >> 16) % nf]);
+    }
+}
+
+/*
+ * Search a position on board bp by iterative deepening to depth d, from an
+ * empty hash table, with the current driver and thread count.  Returns the
+ * time in seconds and adds the node count to *np.
+ */
+static double bench_one(Board *bp, int d, long *np) {
+    Move pv[MAXPLY + 1] = { 0 };
+    tt_clear();
+    search_key = 0;
+    int64_t start = clock_now();
+    for (depth = 1; depth <= d; depth++) {
+        nodes = 0;
+        search(bp, player_to_move(bp), pv, -MAXEVAL, MAXEVAL);
+        *np += nodes;
+    }
+    return (double)(clock_now() - start) / USEC_PER_SEC;
+}
+
+/* Search every benchmark position as bench_one() does; returns the total time and node count. */
+static double bench_run(Board **positions, Board *bp, int d, long *np) {
+    double secs = 0;
+    *np = 0;
+    for (int k = 0; k < BENCH_POSITIONS; k++)
+        secs += bench_one(copybd(positions[k], bp), d, np);
+    return secs;
+}
+
+void bench_speedup(int d, int maxthreads) {
+    int saved_threads = search_threads, saved_driver = search_driver, saved_depth = depth;
+    Board *positions[BENCH_POSITIONS];
+    Board *bp = newbd();
+
+    if (d > MAXPLY) d = MAXPLY;
+    if (maxthreads < 1) maxthreads = 1;
+    if (maxthreads > MAXTHREADS) maxthreads = MAXTHREADS;
+    for (int k = 0; k < BENCH_POSITIONS; k++) {
+        positions[k] = newbd();
+        bench_position(positions[k], (k + 1) * BENCH_SPACING, BENCH_SEED, 1);
+    }
+    search_init();
+
+    printf("%d positions, depth %d\n", BENCH_POSITIONS, d);
+    printf("%-6s %7s %10s %12s %10s %8s\n", "driver", "threads", "seconds", "nodes", "knps", "speedup");
+    for (int drv = SEARCH_LAZY; drv <= SEARCH_YBWC; drv++) {
+        double base = 0;
+        for (int n = 1; n <= maxthreads; n = (n < maxthreads && 2 * n > maxthreads) ? maxthreads : 2 * n) {
+            long nn;
+            search_driver = drv;
+            search_threads = n;
+            double secs = bench_run(positions, bp, d, &nn);
+            if (n == 1) base = secs;
+            printf("%-6s %7d %10.3f %12ld %10.0f %8.2f\n", driver_names[drv], n, secs, nn,
+                   nn / secs / 1000, base / secs);
+            fflush(stdout);
+        }
+    }
+
+    search_threads = saved_threads;
+    search_driver = saved_driver;
+    depth = saved_depth;
+}
+
+long bench_search(int d) {
+    int saved_depth = depth;
+    long total = 0;
+    double secs = 0;
+
+    if (d < 1) d = 1;
+    if (d > MAXPLY) d = MAXPLY;
+    search_init();
+
+    printf("%d positions, depth %d, driver %s, %d thread%s\n", BENCH_POSITIONS, d,
+           driver_names[search_driver], search_threads, search_threads > 1 ? "s" : "");
+    printf("%-8s %12s %10s %10s\n", "position", "nodes", "seconds", "knps");
+    for (int k = 0; k < BENCH_POSITIONS; k++) {
+        long nn = 0;
+        Board *bp = newbd();
+        bench_position(bp, (k + 1) * BENCH_SPACING, BENCH_SEED, 1);
+        double t = bench_one(bp, d, &nn);
+        printf("%-8d %12ld %10.3f %10.0f\n", k + 1, nn, t, t > 0 ? nn / t / 1000 : 0.0);
+        fflush(stdout);
+        total += nn;
+        secs += t;
+    }
+    printf("Total %ld nodes, %.3f s, %.0f nodes/s\n", total, secs, secs > 0 ? total / secs : 0.0);
+
+    depth = saved_depth;
+    return total;
+}
+
+/* Number of move sequences of length d from a position (leaves of the move tree). */
+static long perft_board(Board *bp, int d) {
+    Move list[MAXPOSMOVES];
+    int n = generate_moves(bp, list, NULL);
+    if (d == 1)
+        return n;
+    long leaves = 0;
+    for (int i = 0; i < n; i++) {
+        apply(bp, list[i]);
+        leaves += perft_board(bp, d - 1);
+        undo(bp);
+    }
+    return leaves;
+}
+
+static long perft_bits(BitPosition *b, int d) {
+    Move list[MAXPOSMOVES];
+    int n = bb_generate_moves(b, list);
+    if (d == 1)
+        return n;
+    long leaves = 0;
+    for (int i = 0; i < n; i++) {
+        bb_apply(b, list[i]);
+        leaves += perft_bits(b, d - 1);
+        bb_undo(b, list[i]);
+    }
+    return leaves;
+}
+
+/* Walk the move tree with both generators side by side; count the nodes where their moves differ. */
+static long perft_compare(Board *bp, BitPosition *b, int d) {
+    Move list[MAXPOSMOVES], bits[MAXPOSMOVES];
+    int n = generate_moves(bp, list, NULL);
+    int nb = bb_generate_moves(b, bits);
+    long bad = 0;
+    if (n == nb) {
+        Move sorted[MAXPOSMOVES];
+        memcpy(sorted, list, n * sizeof(Move));
+        qsort(sorted, n, sizeof(Move), cmp_move);
+        qsort(bits, n, sizeof(Move), cmp_move);
+        bad = memcmp(sorted, bits, n * sizeof(Move)) != 0;
+    } else {
+        bad = 1;
+    }
+    if (d == 1)
+        return bad;
+    for (int i = 0; i < n; i++) {
+        apply(bp, list[i]);
+        bb_apply(b, list[i]);
+        bad += perft_compare(bp, b, d - 1);
+        bb_undo(b, list[i]);
+        undo(bp);
+    }
+    return bad;
+}
+
+int bench_movegen(int d) {
+    Board *positions[BENCH_POSITIONS];
+    long bad = 0;
+
+    if (d < 1) d = 1;
+    for (int k = 0; k < BENCH_POSITIONS; k++) {
+        positions[k] = newbd();
+        bench_position(positions[k], k * BENCH_SPACING, BENCH_SEED, 1);
+        BitPosition b;
+        bb_from_board(&b, positions[k]);
+        bad += perft_compare(positions[k], &b, d);
+    }
+
+    printf("%d positions, depth %d, %ld nodes where the generators differ\n", BENCH_POSITIONS, d, bad);
+    printf("%-10s %14s %10s %10s\n", "generator", "leaves", "seconds", "Mleaves/s");
+    for (int g = 0; g < 2; g++) {
+        long leaves = 0;
+        int64_t start = clock_now();
+        for (int k = 0; k < BENCH_POSITIONS; k++) {
+            if (g == 0) {
+                leaves += perft_board(positions[k], d);
+            } else {
+                BitPosition b;
+                bb_from_board(&b, positions[k]);
+                leaves += perft_bits(&b, d);
+            }
+        }
+        double secs = (double)(clock_now() - start) / USEC_PER_SEC;
+        printf("%-10s %14ld %10.3f %10.2f\n", g == 0 ? "board" : "bitboard", leaves, secs, leaves / secs / 1e6);
+        fflush(stdout);
+    }
+    return bad ? -1 : 0;
+}
+
+/*
+ * The evaluators compared by bench_eval(), each called with a position's
+ * index; nnue is set for those that need a network loaded.
+ */
+typedef struct Evaluator {
+    const char *name;
+    int (*fn)(int k, Player p);
+    int nnue;
+} Evaluator;
+
+static Board *eval_positions[EVAL_POSITIONS];
+static NnueAcc eval_accs[EVAL_POSITIONS];  // Accumulators for eval_positions, computed untimed
+static volatile long eval_sink;            // Keeps the timed loops from being optimized away
+
+static int by_lib(int k, Player p) {
+    return eval(eval_positions[k], p);
+}
+
+static int by_totals(int k, Player p) {
+    return evaluate(eval_positions[k], p);
+}
+
+static int by_nnue_full(int k, Player p) {
+    return nnue_evaluate_full(eval_positions[k], p);
+}
+
+/* The network's cost in a search: the win check, then the layers on an up-to-date accumulator. */
+static int by_nnue_layers(int k, Player p) {
+    int e = evaluate(eval_positions[k], p);
+    if (e >= WINEVAL || e <= -WINEVAL)
+        return e;
+    return nnue_evaluate(&eval_accs[k], p);
+}
+
+int bench_eval(int rounds) {
+    static const Evaluator evaluators[] = {
+        { "eval.o", by_lib, 0 },
+        { "evaluate", by_totals, 0 },
+        { "nnue/full", by_nnue_full, 1 },
+        { "nnue/layers", by_nnue_layers, 1 },
+    };
+    int nev = sizeof(evaluators) / sizeof(evaluators[0]);
+    int expected[EVAL_POSITIONS][2];
+    int mismatches = 0;
+
+    for (int k = 0; k < EVAL_POSITIONS; k++) {
+        Board *bp = eval_positions[k] = newbd();
+        bench_position(bp, k % EVAL_MAXPLY, BENCH_SEED + k, 0);
+        for (Player p = X; p <= O; p++)
+            expected[k][p] = eval(bp, p);
+        if (nnue_ready)
+            nnue_reset(&eval_accs[k], bp);
+    }
+
+    printf("%d positions, %d rounds\n", EVAL_POSITIONS, rounds);
+    printf("%-12s %10s %10s\n", "evaluator", "ns/call", "mismatches");
+    for (int e = 0; e < nev; e++) {
+        const Evaluator *ev = &evaluators[e];
+        if (ev->nnue && !nnue_ready)
+            continue;
+        int bad = 0;
+        for (int k = 0; k < EVAL_POSITIONS; k++)
+            for (Player p = X; p <= O; p++)
+                bad += ev->fn(k, p) != expected[k][p];
+        long sum = 0;
+        int64_t start = clock_now();
+        for (int r = 0; r < rounds; r++)
+            for (int k = 0; k < EVAL_POSITIONS; k++)
+                sum += ev->fn(k, r & 1);
+        double secs = (double)(clock_now() - start) / USEC_PER_SEC;
+        eval_sink = sum;
+        printf("%-12s %10.2f %10d\n", ev->name, secs * 1e9 / ((double)rounds * EVAL_POSITIONS), bad);
+        if (!ev->nnue)
+            mismatches += bad;
+    }
+    return mismatches ? -1 : 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Bitboard tables and conversion from the library board.
+ */
+
+#include <pthread.h>
+
+#include "bitboard.h"
+#include "movegen.h"
+
+/* The six neighbour directions, in the same order as rdirect[]/cdirect[]. */
+static const int rdir[6] = { 0, -1, -1,  0,  1, 1 };
+static const int cdir[6] = { 1,  1,  0, -1, -1, 0 };
+
+Bitboard bb_from[6];
+Bitboard bb_goal[2];
+Bitboard bb_swap[2];
+
+static uint8_t pos_of[BB_CELLS];         // BB_POS() of each cell
+static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+static void init(void) {
+    for (int d = 0; d < 6; d++) {
+        for (int r = 0; r < BOARD_SIZE; r++) {
+            for (int c = 0; c < BOARD_SIZE; c++) {
+                int r2 = r + rdir[d], c2 = c + cdir[d];
+                if (r2 >= 0 && r2 < BOARD_SIZE && c2 >= 0 && c2 < BOARD_SIZE)
+                    bb_from[d] |= BB_BIT(r * BOARD_SIZE + c);
+            }
+        }
+    }
+    for (int r = 0; r < BOARD_SIZE; r++) {
+        for (int c = 0; c < BOARD_SIZE; c++) {
+            Bitboard b = BB_BIT(r * BOARD_SIZE + c);
+            pos_of[r * BOARD_SIZE + c] = BB_POS(r * BOARD_SIZE + c);
+            if (r + c >= 2 * (BOARD_SIZE - 1) - 3)
+                bb_goal[X] |= b;
+            if (r + c <= 3)
+                bb_goal[O] |= b;
+            if (r + c >= SWAP_X)
+                bb_swap[X] |= b;
+            if (r + c <= SWAP_O)
+                bb_swap[O] |= b;
+        }
+    }
+}
+
+void bb_from_board(BitPosition *b, Board *bp) {
+    pthread_once(&once, init);
+    for (int p = 0; p < 2; p++) {
+        b->occ[p] = 0;
+        for (int i = 0; i < NPIECES; i++)
+            b->occ[p] |= BB_BIT(BB_SQUARE(bp->pos[p][i]));
+    }
+    b->player = bp->player;
+}
+
+/*
+ * Jump chains as a flood fill.  The board does not change while a chain is
+ * followed (the moving piece still stands on its origin), so the cells from
+ * which a jump in direction d is possible, jumpable[d], are the same for every
+ * piece and every hop: those whose neighbour in direction d is occupied and
+ * whose neighbour beyond that is empty.  From a frontier of landing cells the
+ * next hop lands on (frontier & jumpable[d]) moved two cells in direction d,
+ * which needs no masking since the landing cells are known to exist; the
+ * fill stops when a hop reaches no new cell.
+ */
+static void jumpable(const BitPosition *b, Bitboard jump[7]) {
+    Bitboard occ = b->occ[X] | b->occ[O], empty = BB_ALL & ~occ;
+    jump[6] = 0;                          /* cells with any jump */
+    for (int d = 0; d < 6; d++) {
+        int back = (d + 3) % 6;
+        jump[d] = bb_step(occ & bb_step(empty, back), back);
+        jump[6] |= jump[d];
+    }
+}
+
+static Bitboard landings(Bitboard origin, const Bitboard jump[7]) {
+    if (!(origin & jump[6]))
+        return 0;
+    Bitboard land = 0, frontier = origin;
+    while (frontier) {
+        Bitboard next = 0;
+        for (int d = 0; d < 6; d++)
+            next |= bb_move(frontier & jump[d], 2 * bb_shift[d]);
+        frontier = next & ~land;
+        land |= frontier;
+    }
+    return land;
+}
+
+static int add_moves(Player p, int from, Bitboard to, Move *list) {
+    int n = 0;
+    Move origin = (p << 16) | (pos_of[from] << 8);
+    for (; to; to &= to - 1)
+        list[n++] = origin | pos_of[bb_first(to)];
+    return n;
+}
+
+/* The jumps piece by piece in cell order, each piece's landing cells found by one flood fill. */
+static int all_jumps(const BitPosition *b, Move *list) {
+    Player p = b->player;
+    Bitboard jump[7];
+    jumpable(b, jump);
+    int n = 0;
+    for (Bitboard pieces = b->occ[p]; pieces; pieces &= pieces - 1) {
+        int from = bb_first(pieces);
+        n += add_moves(p, from, landings(BB_BIT(from), jump), list + n);
+    }
+    return n;
+}
+
+/* Steps are generated a direction at a time for all pieces at once. */
+int bb_generate_moves(const BitPosition *b, Move *list) {
+    Player p = b->player;
+    Bitboard target = (BB_ALL & ~(b->occ[X] | b->occ[O])) | (b->occ[!p] & bb_swap[p]);
+    int n = all_jumps(b, list);
+    for (int d = 0; d < 6; d++) {
+        for (Bitboard to = bb_step(b->occ[p], d) & target; to; to &= to - 1) {
+            int sq = bb_first(to);
+            list[n++] = (p << 16) | (pos_of[sq - bb_shift[d]] << 8) | pos_of[sq];
+        }
+    }
+    return n;
+}
+
+int bb_is_legal(const BitPosition *b, Move m) {
+    Move list[MAXPOSMOVES];
+    int n = bb_generate_moves(b, list);
+    for (int i = 0; i < n; i++)
+        if (list[i] == m)
+            return 1;
+    return 0;
+}
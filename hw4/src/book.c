@@ -0,0 +1,232 @@
+/*
+ * Opening book: building from transcripts and probing.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bitboard.h"
+#include "board.h"
+#include "book.h"
+#include "movegen.h"
+#include "search.h"
+#include "tt.h"
+
+#define BOOK_MAGIC "CCBK"
+#define BOOK_VERSION 1
+
+const char *book_path;
+
+typedef struct BookHeader {
+    char magic[4];                        // BOOK_MAGIC
+    uint32_t version;                     // BOOK_VERSION
+    uint64_t entries;                     // Number of entries that follow
+} BookHeader;
+
+/* Entries are sorted by key, and by decreasing weight within a key. */
+typedef struct BookEntry {
+    uint64_t key;                         // tt_board_key() of the position
+    uint32_t move;                        // Move played in it
+    uint32_t weight;                      // Sum of the outcome weights of the games it was played in
+} BookEntry;
+
+static const BookEntry *book;             // Mapped entries, or NULL
+static uint64_t book_size;
+
+static int cmp_key_move(const void *a, const void *b) {
+    const BookEntry *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->move > y->move) - (x->move < y->move);
+}
+
+static int cmp_key_weight(const void *a, const void *b) {
+    const BookEntry *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->weight < y->weight) - (x->weight > y->weight);
+}
+
+/*
+ * Parse a transcript line as print_move() writes it, "white:A3-C3-E3": the
+ * side, then the cells of the move (row letter, column digit) joined by '-'.
+ * Returns the move for player p, or 0 if the line is not a move by p.  The
+ * hops between the first and last cells are not part of a Move and are not
+ * checked.
+ */
+static Move parse_move(const char *line, Player p) {
+    const char *side = p == X ? "white:" : "black:";
+    size_t len = strlen(side);
+    if (strncmp(line, side, len) != 0)
+        return 0;
+    const char *s = line + len;
+    int from = -1, to = -1;
+    for (;;) {
+        if (s[0] < 'A' || s[0] >= 'A' + BOARD_SIZE || s[1] < '1' || s[1] >= '1' + BOARD_SIZE)
+            return 0;
+        to = (s[0] - 'A') << 4 | (s[1] - '1');
+        if (from < 0)
+            from = to;
+        s += 2;
+        if (*s != '-')
+            break;
+        s++;
+    }
+    if (from == to || s[strspn(s, " \t\r\n")] != '\0')
+        return 0;
+    return (p << 16) | (from << 8) | to;
+}
+
+/*
+ * Add the opening of one game to the entries; returns 0 or -1.  The moves
+ * are checked here rather than by read_move_from_pipe(), which aborts on a
+ * bad one.  Keys are taken on bp for the first BOOK_PLY ply; the game is
+ * followed to its end on a BitPosition, which keeps no history, so a game
+ * of any length can be read.
+ */
+static int add_game(const char *name, Board *bp, BookEntry **ep, size_t *np, size_t *capp) {
+    FILE *f = fopen(name, "r");
+    if (f == NULL) {
+        fprintf(stderr, "[book] %s: %s\n", name, strerror(errno));
+        return -1;
+    }
+    BookEntry game[BOOK_PLY];
+    Player movers[BOOK_PLY];
+    BitPosition b;
+    bb_from_board(&b, bp);
+    int n = 0, lineno = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f) != NULL) {
+        lineno++;
+        if (line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+        Move m = parse_move(line, b.player);
+        if (m == 0 || !bb_is_legal(&b, m)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            fprintf(stderr, "[book] %s:%d: not a legal move for %s: %s\n", name, lineno,
+                    b.player == X ? "white" : "black", line);
+            fclose(f);
+            errno = EINVAL;
+            return -1;
+        }
+        if (n < BOOK_PLY) {
+            game[n].key = tt_board_key(bp);
+            game[n].move = m;
+            movers[n++] = bp->player;
+            apply(bp, m);
+        }
+        bb_apply(&b, m);
+    }
+    fclose(f);
+
+    int result = bb_game_over(&b);        // 1: X won, -1: O won, 0: unfinished
+    for (int i = 0; i < n; i++) {
+        int won = movers[i] == X ? result : -result;
+        game[i].weight = won + 1;
+        if (game[i].weight == 0)
+            continue;
+        if (*np == *capp) {
+            *capp = *capp ? 2 * *capp : 1024;
+            BookEntry *e = realloc(*ep, *capp * sizeof(BookEntry));
+            if (e == NULL)
+                return -1;
+            *ep = e;
+        }
+        (*ep)[(*np)++] = game[i];
+    }
+    return 0;
+}
+
+int book_build(const char *path, char *transcripts[], int n) {
+    BookEntry *e = NULL;
+    size_t ne = 0, cap = 0;
+    Board *start = newbd(), *bp = newbd();
+    for (int i = 0; i < n; i++) {
+        copybd(start, bp);
+        if (add_game(transcripts[i], bp, &e, &ne, &cap) < 0) {
+            free(e);
+            return -1;
+        }
+    }
+
+    /* Merge repeated (position, move) pairs, then put the heaviest move first. */
+    size_t nm = 0;
+    if (ne > 0)
+        qsort(e, ne, sizeof(BookEntry), cmp_key_move);
+    for (size_t i = 0; i < ne; i++) {
+        if (nm > 0 && e[nm - 1].key == e[i].key && e[nm - 1].move == e[i].move)
+            e[nm - 1].weight += e[i].weight;
+        else
+            e[nm++] = e[i];
+    }
+    if (nm > 0)
+        qsort(e, nm, sizeof(BookEntry), cmp_key_weight);
+
+    BookHeader h = { BOOK_MAGIC, BOOK_VERSION, nm };
+    FILE *f = fopen(path, "wb");
+    int ok = f != NULL
+        && fwrite(&h, sizeof(h), 1, f) == 1
+        && fwrite(e, sizeof(BookEntry), nm, f) == nm;
+    if (f != NULL && fclose(f) != 0)
+        ok = 0;
+    free(e);
+    if (ok)
+        fprintf(stderr, "[book] %d games, %zu positions and moves\n", n, nm);
+    return ok ? 0 : -1;
+}
+
+int book_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(BookHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+    const BookHeader *h = map;
+    if (memcmp(h->magic, BOOK_MAGIC, 4) != 0 || h->version != BOOK_VERSION
+        || (size_t)st.st_size != sizeof(BookHeader) + h->entries * sizeof(BookEntry)) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+    book = (const BookEntry *)(h + 1);
+    book_size = h->entries;
+    return 0;
+}
+
+Move book_move(Board *bp) {
+    if (book == NULL)
+        return 0;
+    uint64_t key = tt_board_key(bp);
+    uint64_t lo = 0, hi = book_size;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (book[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    uint64_t end = lo, total = 0;
+    while (end < book_size && book[end].key == key)
+        total += book[end++].weight;
+    if (lo == end)
+        return 0;
+
+    uint64_t i = lo;
+    if (randomized) {
+        uint64_t r = (uint64_t)rand() % total;
+        while (r >= book[i].weight)
+            r -= book[i++].weight;
+    }
+    return is_legal(bp, book[i].move) ? book[i].move : 0;
+}
@@ -1,6 +1,7 @@
 #define _POSIX_C_SOURCE 200809L
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -13,7 +14,15 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "bench.h"
+#include "book.h"
 #include "ccheck.h"
+#include "clock.h"
+#include "egtb.h"
+#include "movegen.h"
+#include "nnue.h"
+#include "search.h"
+#include "tt.h"
 #include <stdio.h>
 #include <sys/stat.h>
 
@@ -25,9 +34,35 @@
  *   -v           give info about search
  *   -d           don't try to use X window system display
  *   -t           tournament mode
- *   -a <num>     set average time per move (in seconds)
+ *   -a <time>    set average time per move: seconds, with a fraction if need be (1.5),
+ *                or milliseconds with an "ms" suffix (250ms)
+ *   -c <time>    play on a game clock starting at the given time for each player;
+ *                a player who runs out of time loses
+ *   -g <time>    add the given time to the mover's clock after each move (with -c)
+ *   -m <num>     add the -c time to a player's clock again every <num> moves
+ *   -f <time>    give the engine the given time for every move (overrides -a and -c)
+ *   -D <depth>   make the engine search every move to the given depth, whatever the time
+ *   -L <nodes>   make the engine search every move for the given number of nodes,
+ *                whatever the time (with -j 1, the same moves on every run)
  *   -i <file>    initialize from saved game score
- *   -o <file>    specify transcript file name
+ *   -o <file>    specify transcript file name (one "side:move" line per move, as -i reads)
+ *   -H <MB>      set engine transposition table size (in megabytes)
+ *   -j <num>     set number of engine search threads
+ *   -y           split the search tree between threads (YBWC) instead of Lazy SMP
+ *   -R <b>,<d>   set late move reductions to b + ln(depth) * ln(moveno) / d (d = 0: none)
+ *   -B <depth>   benchmark parallel search speedup to the given depth, then exit
+ *   -M <rounds>  check and time the static evaluators over a set of positions, then exit
+ *   -P <depth>   check and time the move generators to the given depth (perft), then exit
+ *   -S <depth>   search the benchmark positions to the given depth and print the total
+ *                node count and nodes per second, then exit
+ *   -e <file>    use the endgame tablebase in the given file
+ *   -E <file>    build the endgame tablebase and write it to the given file, then exit
+ *   -k <file>    use the opening book in the given file
+ *   -K <file>    build an opening book from the transcripts named after the options
+ *                and write it to the given file, then exit
+ *   -n <file>    evaluate with the neural network whose weights are in the given file
+ *   -N <file>    write the weights of a network equivalent to the classic evaluation
+ *                to the given file, then exit
  */
 
 
@@ -39,9 +74,29 @@ typedef struct Config {
     bool verbose_stats;       // -v -> sets global verbose
     bool no_display;          // -d
     bool tournament_mode;     // -t
-    int  avg_time;            // -a <sec> -> sets global avgtime
+    int64_t avg_time;         // -a <time> (microseconds) -> sets globals clock_avg, avgtime
+    int64_t base_time;        // -c <time> -> sets global clock_base
+    int64_t inc_time;         // -g <time> -> sets global clock_inc
+    int  moves_to_go;         // -m <num> -> sets global clock_mtg
+    int64_t fixed_time;       // -f <time> -> sets global clock_fixed
+    int  fixed_depth;         // -D <depth> -> sets global search_fixed_depth
+    long fixed_nodes;         // -L <nodes> -> sets global search_fixed_nodes
     const char *init_file;    // -i <file>
     const char *transcript;   // -o <file>
+    int  hash_mb;             // -H <MB> -> sets global hash_mb
+    int  threads;             // -j <num> -> sets global search_threads
+    bool ybwc;                // -y -> sets global search_driver
+    const char *lmr;          // -R <base>,<divisor> -> sets globals lmr_base, lmr_divisor
+    int  bench_depth;         // -B <depth>
+    int  bench_eval;          // -M <rounds>
+    int  bench_perft;         // -P <depth>
+    int  bench_search;        // -S <depth>
+    const char *egtb_file;    // -e <file> -> sets global egtb_path
+    const char *egtb_build;   // -E <file>
+    const char *book_file;    // -k <file> -> sets global book_path
+    const char *book_build;   // -K <file>
+    const char *nnue_file;    // -n <file> -> sets global nnue_path
+    const char *nnue_write;   // -N <file>
 } Config;
 
 // ======= Child bookkeeping =======
@@ -74,7 +129,7 @@ extern int times[];         // (declared in header)
 extern Move principal_var[];// (declared in header)
 
 // ======= Utilities =======
-static void die(const char *fmt, ...) __attribute__((format(printf,1,2)));
+static void die(const char *fmt, ...) __attribute__((format(printf,1,2), noreturn));
 static void die(const char *fmt, ...) {
     // Print error then shutdown children and exit.
     va_list ap; va_start(ap, fmt);
@@ -243,13 +298,23 @@ static void spawn_engine_if_needed(const Config *cfg, Board *bp) {
 }
 
 // ======= Argument parsing =======
+// The whole of arg as a number from 1 to max, or die naming option -opt
+static long parse_count(int opt, const char *arg, long max, const char *what) {
+    char *end;
+    errno = 0;
+    long n = strtol(arg, &end, 10);
+    if (end == arg || *end || errno == ERANGE || n < 1 || n > max)
+        die("-%c expects %s from 1 to %ld, not %s", opt, what, max, arg);
+    return n;
+}
+
 static void parse_args(Config *cfg, int argc, char **argv) {
     memset(cfg, 0, sizeof(*cfg));
     cfg->avg_time = 0;
 
     int opt;
     // Leading ':' so getopt returns ':' on missing arg to an option
-    while ((opt = getopt(argc, argv, ":wbrvdta:i:o:")) != -1) {
+    while ((opt = getopt(argc, argv, ":wbrvdta:c:g:m:f:D:L:i:o:H:j:yB:M:P:S:R:e:E:k:K:n:N:")) != -1) {
         switch (opt) {
             case 'w': cfg->play_white_engine = true; break;
             case 'b': cfg->play_black_engine = true; break;
@@ -257,9 +322,41 @@ static void parse_args(Config *cfg, int argc, char **argv) {
             case 'v': cfg->verbose_stats     = true; break;
             case 'd': cfg->no_display        = true; break;
             case 't': cfg->tournament_mode   = true; break;
-            case 'a': cfg->avg_time          = atoi(optarg); break;
+            case 'a':
+                if ((cfg->avg_time = clock_parse(optarg)) < 0)
+                    die("-a expects seconds or <num>ms, not %s", optarg);
+                break;
+            case 'c':
+                if ((cfg->base_time = clock_parse(optarg)) < 0)
+                    die("-c expects seconds or <num>ms, not %s", optarg);
+                break;
+            case 'g':
+                if ((cfg->inc_time = clock_parse(optarg)) < 0)
+                    die("-g expects seconds or <num>ms, not %s", optarg);
+                break;
+            case 'm': cfg->moves_to_go = parse_count('m', optarg, INT_MAX, "a number of moves"); break;
+            case 'f':
+                if ((cfg->fixed_time = clock_parse(optarg)) < 0)
+                    die("-f expects seconds or <num>ms, not %s", optarg);
+                break;
+            case 'D': cfg->fixed_depth       = parse_count('D', optarg, MAXPLY, "a depth"); break;
+            case 'L': cfg->fixed_nodes       = parse_count('L', optarg, LONG_MAX, "a number of nodes"); break;
             case 'i': cfg->init_file         = optarg; break;
             case 'o': cfg->transcript        = optarg; break;
+            case 'H': cfg->hash_mb           = parse_count('H', optarg, INT_MAX, "a size in megabytes"); break;
+            case 'j': cfg->threads           = parse_count('j', optarg, MAXTHREADS, "a number of threads"); break;
+            case 'y': cfg->ybwc              = true; break;
+            case 'B': cfg->bench_depth       = parse_count('B', optarg, MAXPLY, "a depth"); break;
+            case 'M': cfg->bench_eval        = parse_count('M', optarg, INT_MAX, "a number of rounds"); break;
+            case 'P': cfg->bench_perft       = parse_count('P', optarg, MAXPLY, "a depth"); break;
+            case 'S': cfg->bench_search      = parse_count('S', optarg, MAXPLY, "a depth"); break;
+            case 'R': cfg->lmr               = optarg; break;
+            case 'e': cfg->egtb_file         = optarg; break;
+            case 'E': cfg->egtb_build        = optarg; break;
+            case 'k': cfg->book_file         = optarg; break;
+            case 'K': cfg->book_build        = optarg; break;
+            case 'n': cfg->nnue_file         = optarg; break;
+            case 'N': cfg->nnue_write        = optarg; break;
             case ':': die("missing argument for -%c", optopt);
             default:  die("unknown option -%c", optopt);
         }
@@ -268,7 +365,24 @@ static void parse_args(Config *cfg, int argc, char **argv) {
     // Set global knobs expected by engine/lib
     randomized = cfg->randomized_play ? 1 : 0;
     verbose   = cfg->verbose_stats   ? 1 : 0;
-    avgtime   = cfg->avg_time;
+    clock_avg = cfg->avg_time;
+    avgtime   = (int)((cfg->avg_time + USEC_PER_SEC - 1) / USEC_PER_SEC);
+    clock_base  = cfg->base_time;
+    clock_inc   = cfg->inc_time;
+    clock_mtg   = cfg->moves_to_go > 0 ? cfg->moves_to_go : 0;
+    clock_fixed = cfg->fixed_time;
+    if ((clock_inc > 0 || clock_mtg > 0) && clock_base == 0)
+        die("-g and -m need a game clock (-c)");
+    search_fixed_depth = cfg->fixed_depth > 0 ? cfg->fixed_depth : 0;
+    search_fixed_nodes = cfg->fixed_nodes > 0 ? cfg->fixed_nodes : 0;
+    if (cfg->hash_mb > 0) hash_mb = cfg->hash_mb;
+    if (cfg->threads > 0) search_threads = cfg->threads;
+    if (cfg->ybwc) search_driver = SEARCH_YBWC;
+    if (cfg->lmr && sscanf(cfg->lmr, "%lf,%lf", &lmr_base, &lmr_divisor) != 2)
+        die("-R expects <base>,<divisor>");
+    egtb_path = cfg->egtb_file;
+    book_path = cfg->book_file;
+    nnue_path = cfg->nnue_file;
 }
 
 // ======= History loading (pushes to display, no engine yet) =======
@@ -295,6 +409,15 @@ static void parse_args(Config *cfg, int argc, char **argv) {
 
 
 
+// ======= Transcript helpers =======
+// One "side:move" line per move (print_move() writes the side), as -i and -K read them
+static void write_transcript_move(Board *bp, Move m) {
+    if (!g_tx) return;
+    print_move(bp, m, g_tx);
+    fputc('\n', g_tx);
+    fflush(g_tx);
+}
+
 static void load_history_if_any(Board *bp, const Config *cfg) {
     if (!cfg->init_file) return;
     FILE *f = fopen(cfg->init_file, "r");
@@ -307,20 +430,10 @@ static void load_history_if_any(Board *bp, const Config *cfg) {
         Player p = player_to_move(bp); // side about to play
         // Update display BEFORE applying so hops are derived from the correct state
         send_display_move(bp, p, m);
-        // Apply on our board state
+        write_transcript_move(bp, m);
+        // Apply on our board state (its history holds only MAXHIST moves)
+        make_history_room(bp, 1);
         apply(bp, m);
-        // Minimal transcript of history (optional): you can enhance if needed.
-        if (g_tx) {
-            int ply = move_number(bp) - 1; // just applied
-            int turn = (ply / 2) + 1;
-            const char *side = (p == X) ? "white" : "black";
-            char mv[128]; FILE *mem = fmemopen(mv, sizeof(mv), "w");
-            if (!mem) die("fmemopen: %s", strerror(errno));
-            print_move(bp, m, mem); fflush(mem); fclose(mem);
-            if (p == X) fprintf(g_tx, "%d. %s:%s", turn, side, mv);
-            else        fprintf(g_tx, "%d. ... %s:%s", turn, side, mv);
-            fflush(g_tx);
-        }
     }
     fclose(f);
 }
@@ -330,7 +443,8 @@ static void notify_engine_of_opponent_move(Board *bp, Player mover, const Config
     if (g_eng_pid <= 0) return;
     bool engine_is_white = cfg->play_white_engine;
     bool engine_is_black = cfg->play_black_engine;
-    bool mover_is_opponent = (mover == X && engine_is_black) || (mover == O && engine_is_white);
+    // With -w -b one engine plays both sides and has already applied its own move
+    bool mover_is_opponent = (mover == X && !engine_is_white) || (mover == O && !engine_is_black);
     if (!mover_is_opponent) return;
 
     char mvbuf[128]; FILE *mem = fmemopen(mvbuf, sizeof(mvbuf), "w");
@@ -338,7 +452,7 @@ static void notify_engine_of_opponent_move(Board *bp, Player mover, const Config
     print_move(bp, m, mem); fflush(mem); fclose(mem);
 
     const char *side = (mover == X) ? "white" : "black";
-    char line[192]; snprintf(line, sizeof(line), ">%s:%s", side, mvbuf);
+    char line[192]; snprintf(line, sizeof(line), ">%s:%s\n", side, mvbuf);
 
     char ack[192];
     if (!send_line_hup_expect_ack(g_eng_in, g_eng_pid, g_eng_out, line, ack, sizeof(ack)))
@@ -389,23 +503,10 @@ fprintf(stderr, "[ccheck] line 386\n"); //ming
     return m;
 }
 
-// ======= Transcript helpers =======
-static void write_transcript_move(Board *bp, Player p, Move m) {
-    if (!g_tx) return;
-    int ply_before_apply = move_number(bp); // pending ply index
-    int turn = (ply_before_apply / 2) + 1;
-    const char *side = (p == X) ? "white" : "black";
-    char mv[128]; FILE *mem = fmemopen(mv, sizeof(mv), "w");
-    if (!mem) die("fmemopen: %s", strerror(errno));
-    print_move(bp, m, mem); fflush(mem); fclose(mem);
-    if (p == X) fprintf(g_tx, "%d. %s:%s", turn, side, mv);
-    else        fprintf(g_tx, "%d. ... %s:%s", turn, side, mv);
-    fflush(g_tx);
-}
-
 // ======= Main game loop (full move flow) =======
 static void game_loop(Board *bp, const Config *cfg) {
     info("entering main game loop");
+    clock_reset(move_number(bp));
 
     for (;;) {
         if (g_got_sigint || g_got_sigterm) {
@@ -450,10 +551,16 @@ fprintf(stderr, "[ccheck] line 444\n"); //ming
 
 
         // Timekeeping: charge the mover for time up to this point before applying
-        setclock(p);
+        clock_charge(p);
+        if (clock_base > 0 && clock_fixed == 0 && clock_left(p, move_number(bp)) < 0) {
+            if (p == X) fprintf(stdout, "X (white) loses on time!");
+            else        fprintf(stdout, "O (black) loses on time!");
+            fflush(stdout);
+            break;
+        }
 
         // Before applying, update transcript based on current board and mover
-        write_transcript_move(bp, p, m);
+        write_transcript_move(bp, m);
 
 fprintf(stderr, "[ccheck] reached echo-to-display gate. no_display=%d, came_from_display=%d\n", (int)cfg->no_display, (int)came_from_display); //ming
 
@@ -496,7 +603,8 @@ fprintf(stderr, "[xdisp -> ccheck] %s", ack);//ming
             fflush(stdout);
         }
 fprintf(stderr, "[ccheck] line 499\n"); //ming
-        // Apply the move to our authoritative board state
+        // Apply the move to our authoritative board state (its history holds only MAXHIST moves)
+        make_history_room(bp, 1);
         apply(bp, m);
 
         // If the engine exists and this move was by its opponent, notify the engine
@@ -508,6 +616,44 @@ fprintf(stderr, "[ccheck] line 499\n"); //ming
 int ccheck(int argc, char *argv[]) {
     Config cfg; parse_args(&cfg, argc, argv);
 
+    // Benchmarks run standalone: no display, engine or game
+    if (cfg.bench_depth > 0) {
+        int maxthreads = cfg.threads > 0 ? cfg.threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        bench_speedup(cfg.bench_depth, maxthreads);
+        return EXIT_SUCCESS;
+    }
+    if (cfg.bench_search > 0) {
+        if (egtb_path && egtb_open(egtb_path) < 0)
+            die("could not map endgame tablebase %s", egtb_path);
+        if (nnue_path && nnue_open(nnue_path) < 0)
+            die("could not load network %s", nnue_path);
+        bench_search(cfg.bench_search);
+        return EXIT_SUCCESS;
+    }
+    if (cfg.bench_perft > 0)
+        return bench_movegen(cfg.bench_perft) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (cfg.nnue_write) {
+        if (nnue_write_default(cfg.nnue_write) < 0)
+            die("write -N %s: %s", cfg.nnue_write, strerror(errno));
+        return EXIT_SUCCESS;
+    }
+    if (cfg.bench_eval > 0) {
+        if (nnue_path && nnue_open(nnue_path) < 0)
+            die("could not load network %s", nnue_path);
+        return bench_eval(cfg.bench_eval) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (cfg.egtb_build) {
+        int nthreads = cfg.threads > 0 ? cfg.threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (egtb_generate(cfg.egtb_build, nthreads) < 0)
+            die("write -E %s: %s", cfg.egtb_build, strerror(errno));
+        return EXIT_SUCCESS;
+    }
+    if (cfg.book_build) {
+        if (book_build(cfg.book_build, argv + optind, argc - optind) < 0)
+            die("build -K %s: %s", cfg.book_build, strerror(errno));
+        return EXIT_SUCCESS;
+    }
+
     install_handlers();
 
     // Open transcript if requested
@@ -0,0 +1,122 @@
+/*
+ * Time accounting in microseconds on the monotonic clock.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "clock.h"
+
+int64_t clock_avg;
+int64_t clock_base;
+int64_t clock_inc;
+int clock_mtg;
+int64_t clock_fixed;
+int64_t clock_used[2];
+int64_t clock_moved;
+int64_t clock_searched;
+
+static int start_ply;                     // Ply at which the clocks were started
+
+int64_t clock_iter[MAXPLY + 1];
+double clock_branching = CLOCK_BRANCHING;
+
+/* Weight of a move's share of the time left, in percent, by ply / 10. */
+static const int phase_weight[] = { 60, 70, 100, 130, 140, 140, 130, 110, 90, 80 };
+
+int64_t clock_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+int64_t clock_parse(const char *s) {
+    char *end;
+    double x = strtod(s, &end);
+    if (end == s || !isfinite(x) || x < 0 || x * USEC_PER_SEC >= (double)INT64_MAX)
+        return -1;
+    if (strcmp(end, "ms") == 0)
+        return (int64_t)(x * 1000);
+    if (*end == '\0' || strcmp(end, "s") == 0)
+        return (int64_t)(x * USEC_PER_SEC);
+    return -1;
+}
+
+void clock_reset(int ply) {
+    start_ply = ply;
+    clock_used[X] = clock_used[O] = 0;
+    clock_moved = clock_now();
+    movetime = time(NULL);
+}
+
+void clock_charge(Player p) {
+    int64_t now = clock_now();
+    clock_used[p] += now - clock_moved;
+    clock_moved = now;
+    setclock(p);
+}
+
+/* Number of moves p has made on the clock before ply (p moves at the ply of its parity). */
+static int moves_made(Player p, int ply) {
+    return (ply - p + 1) / 2 - (start_ply - p + 1) / 2;
+}
+
+int64_t clock_left(Player p, int ply) {
+    int made = moves_made(p, ply);
+    int periods = clock_mtg > 0 ? made / clock_mtg + 1 : 1;
+    return clock_base * periods + clock_inc * made - clock_used[p];
+}
+
+int clock_movestogo(Player p, int ply) {
+    return clock_mtg > 0 ? clock_mtg - moves_made(p, ply) % clock_mtg : 0;
+}
+
+void clock_start(void) {
+    clock_searched = clock_now();
+}
+
+void clock_timings(int d) {
+    clock_iter[d] = clock_now() - clock_searched;
+    if (d > 1 && clock_iter[d - 1] >= CLOCK_MIN_SAMPLE)
+        clock_branching = (3 * clock_branching + (double)clock_iter[d] / clock_iter[d - 1]) / 4;
+}
+
+int64_t clock_estimate(int d) {
+    return (int64_t)(clock_iter[d] * clock_branching);
+}
+
+void clock_limits(int64_t left, int64_t inc, int movestogo, int ply, TimeLimits *tl) {
+    int moves = movestogo;
+    if (moves <= 0) {
+        moves = (CLOCK_GAME_PLY - ply) / 2;
+        if (moves < CLOCK_MIN_MOVES)
+            moves = CLOCK_MIN_MOVES;
+    }
+    int nphase = sizeof(phase_weight) / sizeof(phase_weight[0]);
+    int64_t share = (left + inc * (moves - 1) - CLOCK_OVERHEAD * moves) / moves;
+    if (share < 0)
+        share = 0;
+    tl->soft = share * phase_weight[ply / 10 < nphase ? ply / 10 : nphase - 1] / 100;
+    tl->hard = tl->soft * CLOCK_HARD_FACTOR;
+    if (tl->hard > left - left / CLOCK_RESERVE - CLOCK_OVERHEAD)
+        tl->hard = left - left / CLOCK_RESERVE - CLOCK_OVERHEAD;
+    if (clock_base > 0 && moves > 1 && tl->hard > left / 2)
+        tl->hard = left / 2;
+    if (tl->hard < 0)
+        tl->hard = 0;
+    if (tl->soft > tl->hard)
+        tl->soft = tl->hard;
+}
+
+int clock_continue(const TimeLimits *tl, int64_t elapsed, int64_t estimate, int stable, int drop) {
+    int64_t soft = tl->soft;
+    if (stable >= CLOCK_STABLE_ITERS)
+        soft /= 2;
+    if (drop >= CLOCK_PANIC_DROP)
+        soft *= 2;
+    if (soft > tl->hard)
+        soft = tl->hard;
+    return elapsed < soft && elapsed + estimate <= tl->hard;
+}
@@ -0,0 +1,365 @@
+/*
+ * Endgame tablebase for the race home: generation and probing.
+ *
+ * A placement is a bitmask over the region's cells (numbered in row-major
+ * order, from X's point of view) with one bit per piece.  Its index in the
+ * table is its rank among all such masks in increasing numeric order, which
+ * is the combinatorial number system.
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "board.h"
+#include "egtb.h"
+
+#define MAXCELL (2 * (BOARD_SIZE - 1))    // Largest row + col on the board
+#define FIRST_DIAG (MAXCELL + 1 - EGTB_LINE)  // Least row + col in X's region
+#define NCELLS_TB 28                      // Cells in the region (1 + 2 + ... + EGTB_LINE)
+#define NCELLS_BORDER (EGTB_LINE + 1)     // Cells on the diagonal just outside the region
+#define HOME_DIAG (MAXCELL - 3)           // Least row + col in X's home
+#define EGTB_MAGIC "CCTB"
+#define EGTB_VERSION 1
+
+_Static_assert(NCELLS_TB == EGTB_LINE * (EGTB_LINE + 1) / 2, "region size");
+
+const char *egtb_path;
+
+typedef struct EgtbHeader {
+    char magic[4];                        // EGTB_MAGIC
+    uint32_t version;                     // EGTB_VERSION
+    uint32_t line;                        // EGTB_LINE
+    uint32_t pieces;                      // NPIECES
+    uint64_t entries;                     // Number of placements that follow
+} EgtbHeader;
+
+/*
+ * Geometry of the region, from X's point of view.  Cells on the diagonal just
+ * outside it are numbered after the region's own: a jump chain may pass
+ * through them, as long as it ends inside.
+ */
+static int region[BOARD_SIZE][BOARD_SIZE];  // Cell number, or -1
+static int step_to[NCELLS_TB][6];         // Neighbour in the region in each direction, or -1
+static int jump_over[NCELLS_TB + NCELLS_BORDER][6];  // Region cell jumped over in each direction, or -1
+static int jump_to[NCELLS_TB + NCELLS_BORDER][6];    // Landing cell in each direction, or -1
+static uint32_t home_mask;                // Placement with every piece home
+
+/* rank_tab[b][v][k]: rank contribution of byte b of a mask holding v, with k pieces below it. */
+static uint32_t rank_tab[4][256][NPIECES + 1];
+static uint32_t binom[NCELLS_TB + 1][NPIECES + 1];
+static uint32_t nentries;
+
+static const uint8_t *table;              // Mapped distances, or NULL
+static int geometry_ready;
+
+static const int rdir[6] = { 0, -1, -1,  0,  1, 1 };
+static const int cdir[6] = { 1,  1,  0, -1, -1, 0 };
+
+/* Number of a region cell (or a border cell, if border is set), or -1. */
+static int region_cell(int r, int c, int border) {
+    if (r < 0 || r >= BOARD_SIZE || c < 0 || c >= BOARD_SIZE)
+        return -1;
+    return border || region[r][c] < NCELLS_TB ? region[r][c] : -1;
+}
+
+static void init_geometry(void) {
+    if (geometry_ready)
+        return;
+    int n = 0, nb = NCELLS_TB;
+    int rows[NCELLS_TB + NCELLS_BORDER], cols[NCELLS_TB + NCELLS_BORDER];
+    for (int r = 0; r < BOARD_SIZE; r++) {
+        for (int c = 0; c < BOARD_SIZE; c++) {
+            region[r][c] = -1;
+            if (r + c >= FIRST_DIAG) {
+                rows[n] = r;
+                cols[n] = c;
+                if (r + c >= HOME_DIAG)
+                    home_mask |= 1u << n;
+                region[r][c] = n++;
+            } else if (r + c == FIRST_DIAG - 1) {
+                rows[nb] = r;
+                cols[nb] = c;
+                region[r][c] = nb++;
+            }
+        }
+    }
+    for (int i = 0; i < NCELLS_TB + NCELLS_BORDER; i++) {
+        for (int d = 0; d < 6; d++) {
+            int r = rows[i] + rdir[d], c = cols[i] + cdir[d];
+            if (i < NCELLS_TB)
+                step_to[i][d] = region_cell(r, c, 0);
+            jump_over[i][d] = region_cell(r, c, 0);
+            jump_to[i][d] = jump_over[i][d] < 0 ? -1 : region_cell(r + rdir[d], c + cdir[d], 1);
+        }
+    }
+    for (int i = 0; i <= NCELLS_TB; i++) {
+        binom[i][0] = 1;
+        for (int k = 1; k <= NPIECES; k++)
+            binom[i][k] = i == 0 ? 0 : binom[i - 1][k - 1] + binom[i - 1][k];
+    }
+    nentries = binom[NCELLS_TB][NPIECES];
+    for (int b = 0; b < 4; b++) {
+        for (int v = 0; v < 256; v++) {
+            for (int k = 0; k <= NPIECES; k++) {
+                uint32_t sum = 0;
+                int j = k;
+                for (int bit = 0; bit < 8 && j < NPIECES; bit++) {
+                    if (v & (1 << bit)) {
+                        int cell = 8 * b + bit;
+                        if (cell < NCELLS_TB)
+                            sum += binom[cell][j + 1];
+                        j++;
+                    }
+                }
+                rank_tab[b][v][k] = sum;
+            }
+        }
+    }
+    geometry_ready = 1;
+}
+
+/* Index of a placement in the table. */
+static uint32_t rank_of(uint32_t m) {
+    int k1 = __builtin_popcount(m & 0xff);
+    int k2 = k1 + __builtin_popcount(m & 0xff00);
+    int k3 = k2 + __builtin_popcount(m & 0xff0000);
+    return rank_tab[0][m & 0xff][0] + rank_tab[1][(m >> 8) & 0xff][k1]
+        + rank_tab[2][(m >> 16) & 0xff][k2] + rank_tab[3][m >> 24][k3];
+}
+
+/* Placement with a given index. */
+static uint32_t unrank(uint32_t x) {
+    uint32_t m = 0;
+    int cell = NCELLS_TB - 1;
+    for (int k = NPIECES; k > 0; k--) {
+        while (binom[cell][k] > x)
+            cell--;
+        m |= 1u << cell;
+        x -= binom[cell][k];
+        cell--;
+    }
+    return m;
+}
+
+/* The next placement in increasing order (Gosper's hack). */
+static uint32_t next_placement(uint32_t m) {
+    uint32_t t = m | (m - 1);
+    return (t + 1) | (((~t & -~t) - 1) >> (__builtin_ctz(m) + 1));
+}
+
+/*
+ * Call f for every placement reachable from m in one move that ends inside
+ * the region.  With vacate set, a moving piece's starting cell is treated as
+ * empty during its jump chain; otherwise (as in the game) it is still there
+ * to be jumped over.  Moves with vacate set are a subset of the game's and
+ * can be taken back, so they make an undirected graph.
+ */
+typedef void (*PlacementFn)(uint32_t m, void *arg);
+
+static void for_each_move(uint32_t m, int vacate, PlacementFn f, void *arg) {
+    for (uint32_t pieces = m; pieces; pieces &= pieces - 1) {
+        int from = __builtin_ctz(pieces);
+        uint32_t rest = m & ~(1u << from);
+        uint32_t occ = vacate ? rest : m;
+        for (int d = 0; d < 6; d++) {
+            int to = step_to[from][d];
+            if (to >= 0 && !(m & (1u << to)))
+                f(rest | (1u << to), arg);
+        }
+        int frontier[NCELLS_TB + NCELLS_BORDER], nf = 0;
+        uint64_t seen = 1ull << from;
+        frontier[nf++] = from;
+        for (int i = 0; i < nf; i++) {
+            for (int d = 0; d < 6; d++) {
+                int over = jump_over[frontier[i]][d], to = jump_to[frontier[i]][d];
+                if (over < 0 || to < 0 || !(occ & (1u << over)) || (m | seen) & (1ull << to))
+                    continue;
+                seen |= 1ull << to;
+                frontier[nf++] = to;
+                if (to < NCELLS_TB)
+                    f(rest | (1u << to), arg);
+            }
+        }
+    }
+}
+
+/* Generation: the table is built in place, one pass over it per step. */
+static uint8_t *gen_table;
+
+typedef struct GenPass {
+    uint32_t lo, hi;                      // Range of placements handled by this thread
+    int level;                            // Distance being expanded (breadth-first passes)
+    long changed;                         // Entries set or lowered
+} GenPass;
+
+typedef struct Visit {
+    GenPass *pass;
+    int best;
+} Visit;
+
+static void set_if_unknown(uint32_t m, void *arg) {
+    Visit *v = arg;
+    uint8_t unknown = EGTB_UNKNOWN;
+    if (__atomic_compare_exchange_n(&gen_table[rank_of(m)], &unknown, (uint8_t)(v->pass->level + 1),
+                                    0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        v->pass->changed++;
+}
+
+static void take_min(uint32_t m, void *arg) {
+    Visit *v = arg;
+    int d = __atomic_load_n(&gen_table[rank_of(m)], __ATOMIC_RELAXED);
+    if (d < v->best)
+        v->best = d;
+}
+
+/* Breadth-first step: give distance level + 1 to every unknown neighbour of distance level. */
+static void *expand(void *arg) {
+    GenPass *pass = arg;
+    Visit v = { pass, 0 };
+    uint32_t m = unrank(pass->lo);
+    for (uint32_t x = pass->lo; x < pass->hi; x++, m = next_placement(m))
+        if (__atomic_load_n(&gen_table[x], __ATOMIC_RELAXED) == pass->level)
+            for_each_move(m, 1, set_if_unknown, &v);
+    return NULL;
+}
+
+/* Correction step: lower each distance to one more than the best of its moves under the game's rules. */
+static void *relax(void *arg) {
+    GenPass *pass = arg;
+    uint32_t m = unrank(pass->lo);
+    for (uint32_t x = pass->lo; x < pass->hi; x++, m = next_placement(m)) {
+        if (m == home_mask)
+            continue;
+        Visit v = { pass, EGTB_UNKNOWN };
+        for_each_move(m, 0, take_min, &v);
+        if (v.best + 1 < __atomic_load_n(&gen_table[x], __ATOMIC_RELAXED)) {
+            __atomic_store_n(&gen_table[x], (uint8_t)(v.best + 1), __ATOMIC_RELAXED);
+            pass->changed++;
+        }
+    }
+    return NULL;
+}
+
+/* Run one step over the whole table on nthreads threads; returns the entries changed. */
+static long run_pass(void *(*fn)(void *), int level, int nthreads) {
+    pthread_t tids[nthreads];
+    GenPass passes[nthreads];
+    long changed = 0;
+    int started = 0;
+    for (int i = 0; i < nthreads; i++) {
+        passes[i].lo = (uint64_t)nentries * i / nthreads;
+        passes[i].hi = (uint64_t)nentries * (i + 1) / nthreads;
+        passes[i].level = level;
+        passes[i].changed = 0;
+        if (i > 0 && pthread_create(&tids[i], NULL, fn, &passes[i]) == 0)
+            started |= 1 << (i & 31);
+        else
+            fn(&passes[i]);
+    }
+    for (int i = 1; i < nthreads; i++)
+        if (started & (1 << (i & 31)))
+            pthread_join(tids[i], NULL);
+    for (int i = 0; i < nthreads; i++)
+        changed += passes[i].changed;
+    return changed;
+}
+
+int egtb_generate(const char *path, int nthreads) {
+    init_geometry();
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > 32) nthreads = 32;
+    gen_table = malloc(nentries);
+    if (gen_table == NULL)
+        return -1;
+    memset(gen_table, EGTB_UNKNOWN, nentries);
+
+    /*
+     * Distances in the undirected graph of moves with the starting cell
+     * vacated are found breadth-first from home; they are upper bounds for
+     * the game's rules, which also allow a piece to jump over the cell it
+     * started from.  Relaxation passes then bring them down to the exact
+     * distances.
+     */
+    gen_table[rank_of(home_mask)] = 0;
+    long n;
+    for (int level = 0; level < EGTB_UNKNOWN - 1; level++) {
+        n = run_pass(expand, level, nthreads);
+        fprintf(stderr, "[egtb] distance %d: %ld placements\n", level + 1, n);
+        if (n == 0)
+            break;
+    }
+    do {
+        n = run_pass(relax, 0, nthreads);
+        fprintf(stderr, "[egtb] relaxation: %ld distances lowered\n", n);
+    } while (n > 0);
+
+    EgtbHeader h = { EGTB_MAGIC, EGTB_VERSION, EGTB_LINE, NPIECES, nentries };
+    FILE *f = fopen(path, "wb");
+    int ok = f != NULL
+        && fwrite(&h, sizeof(h), 1, f) == 1
+        && fwrite(gen_table, 1, nentries, f) == nentries;
+    if (f != NULL && fclose(f) != 0)
+        ok = 0;
+    free(gen_table);
+    gen_table = NULL;
+    return ok ? 0 : -1;
+}
+
+int egtb_open(const char *path) {
+    init_geometry();
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    size_t size = sizeof(EgtbHeader) + nentries;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size != size) {
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return -1;
+    const EgtbHeader *h = map;
+    if (memcmp(h->magic, EGTB_MAGIC, 4) != 0 || h->version != EGTB_VERSION
+        || h->line != EGTB_LINE || h->pieces != NPIECES || h->entries != nentries) {
+        munmap(map, size);
+        return -1;
+    }
+    table = (const uint8_t *)(h + 1);
+    return 0;
+}
+
+int egtb_distance(Board *bp, Player p) {
+    if (table == NULL)
+        return -1;
+    uint32_t m = 0;
+    for (int i = 0; i < NPIECES; i++) {
+        int r = POS_ROW(bp->pos[p][i]), c = POS_COL(bp->pos[p][i]);
+        if (p == O) {
+            r = BOARD_SIZE - 1 - r;
+            c = BOARD_SIZE - 1 - c;
+        }
+        if (region[r][c] < 0 || region[r][c] >= NCELLS_TB)
+            return -1;
+        m |= 1u << region[r][c];
+    }
+    for (int i = 0; i < NPIECES; i++) {
+        int r = POS_ROW(bp->pos[1 - p][i]), c = POS_COL(bp->pos[1 - p][i]);
+        if (p == O) {
+            r = BOARD_SIZE - 1 - r;
+            c = BOARD_SIZE - 1 - c;
+        }
+        if (r + c >= FIRST_DIAG - 2)
+            return -1;
+    }
+    int d = table[rank_of(m)];
+    return d == EGTB_UNKNOWN ? -1 : d;
+}
@@ -16,11 +16,19 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <pthread.h>
 #include <signal.h>
 #include <time.h>
 
 #include "ccheck.h"
+#include "board.h"
+#include "book.h"
+#include "clock.h"
 #include "debug.h"
+#include "egtb.h"
+#include "movegen.h"
+#include "nnue.h"
+#include "search.h"
 #include <unistd.h>
 
 extern int depth;
@@ -31,10 +39,34 @@ extern int bestmove(Board *bp, Player p, int ply, Move pv[], int alpha, int beta
 extern void reset_stats(void);
 extern void print_stats(void);
 extern void print_pvar(Board *bp, int ply);
-extern void timings(int d);
 
-/* Time-control knobs from the lib (safe defaults below if they’re 0): */
-extern int avgtime;
+static int searches = 0;    /* number of moves this engine has searched for */
+
+/*
+ * Pondering.  After playing a move, the engine guesses the opponent's reply
+ * (the second move of its principal variation) and searches the position
+ * after it on a thread of its own, on a copy of the board, while the main
+ * loop waits for the parent.  If the parent then forwards the guessed move,
+ * the ponder search carries on as the search for our next move; otherwise it
+ * is stopped, and what it stored in the transposition table is kept.
+ *
+ * While a ponder search runs, search_key is the key of the position after
+ * the guessed move; key0 holds the key of the engine's board.
+ */
+static struct {
+    pthread_t tid;
+    int active;                     /* a ponder thread is running (or not yet joined) */
+    int hit;                        /* the opponent played the guessed move */
+    Board *bp;                      /* the board, with the guessed move applied */
+    Move guess;                     /* the guessed reply */
+    uint64_t key0;                  /* search_key of the engine's board */
+    pthread_mutex_t lock;           /* protects the fields below, clock_iter[] and clock_branching */
+    pthread_cond_t cond;            /* signalled at the end of each iteration (on CLOCK_MONOTONIC) */
+    Move pv[MAXPLY + 1];            /* principal variation of the last iteration */
+    int depth;                      /* depth of the last iteration completed (0 if none) */
+    int64_t iterstart;              /* clock_now() at which the iteration under way began */
+    int finished;                   /* the thread has stopped deepening */
+} ponder = { .lock = PTHREAD_MUTEX_INITIALIZER };
 
 
 static int read_line(char *buf, size_t n, FILE *in) {
@@ -57,6 +89,236 @@ static Move parse_forwarded_move(Board *bp, const char *line) {
     return m; /* 0 only if EOF was in mvtxt (malformed) */
 }
 
+/*
+ * The number of ply played in the game, counted here as the engine plays
+ * them.  Not move_number(): the search makes and takes back its moves on the
+ * engine's board, and undo() leaves the move number as it is.  Nor the
+ * board's history: search_apply() drops its oldest moves in a long game.
+ */
+static int game_ply;
+
+/*
+ * Iterative deepening: search to depth 1, 2, 3, ... seeding each iteration
+ * with the previous principal variation, for as long as clock_continue()
+ * allows within the limits clock_limits() sets for this move.  On a game
+ * clock the time left is clock_left() and each later move adds the
+ * increment to it.  Otherwise the time left is the average time per move
+ * times the number of moves made so far (plus this one), less the time
+ * already charged to us by clock_charge(), and each later move adds the
+ * average time to it.  A fixed time per move is both limits, and the
+ * search deepens until it is stopped there.
+ *
+ * An estimate can be short, so the hard limit is also the search's deadline:
+ * an iteration still running when it passes stops itself (see search()),
+ * and the move of the last iteration completed is played.  The first
+ * iteration has no deadline, so that there is always a move.
+ *
+ * With search_fixed_depth or search_fixed_nodes set the clock is not looked
+ * at: the search deepens to the fixed depth, or until it has searched the
+ * fixed number of nodes (counted over all iterations), when the iteration
+ * under way is stopped as at a deadline.  With one thread the same position
+ * and hash table then give the same move on every run and every machine.
+ */
+static void time_limits(Board *bp, TimeLimits *tl) {
+    Player me = player_to_move(bp);
+    int ply = game_ply;
+    if (clock_fixed > 0) {
+        tl->soft = tl->hard = clock_fixed;
+    } else if (clock_base > 0) {
+        clock_limits(clock_left(me, ply), clock_inc, clock_movestogo(me, ply), ply, tl);
+    } else {
+        int64_t avg = clock_avg > 0 ? clock_avg : CLOCK_DEFAULT_AVG;
+        clock_limits(avg * (searches + 1) - clock_used[me], avg, 0, ply, tl);
+    }
+}
+
+static int64_t deadline_hit;   /* deadline at which think() last stopped a search, 0 if it did not */
+
+static Move think(Board *bp) {
+    Player me = player_to_move(bp);
+    TimeLimits tl;
+    time_limits(bp, &tl);
+    int64_t start = clock_now();
+    int64_t deadline = start + tl.hard;
+    int scores[MAXPLY + 1];
+    Move done[MAXPLY + 1];          /* principal variation of the last iteration completed */
+    Move best = 0;
+    int stable = 0;                 /* iterations in a row that chose best */
+    int fixed = search_fixed_depth > 0 || search_fixed_nodes > 0;
+    int maxdepth = search_fixed_depth > 0 && search_fixed_depth < MAXPLY ? search_fixed_depth : MAXPLY;
+    long spent = 0;                 /* nodes searched by the iterations so far */
+
+    searches++;
+    if (verbose && !fixed)
+        fprintf(stderr, "Time limits: soft %.3f, hard %.3f\n",
+                (double)tl.soft / USEC_PER_SEC, (double)tl.hard / USEC_PER_SEC);
+    deadline_hit = 0;
+    memset(principal_var, 0, (MAXPLY + 1) * sizeof(Move));
+    for (depth = 1; depth <= maxdepth; depth++) {
+        reset_stats();
+        reset_search_stats();
+        clock_start();
+        memcpy(done, principal_var, sizeof(done));
+        search_deadline = depth > 1 && !fixed ? deadline : 0;
+        search_node_limit = depth > 1 && search_fixed_nodes > 0 ? search_fixed_nodes - spent : 0;
+        int score = search_aspiration(bp, me, principal_var,
+                                      depth > 2 ? scores[depth - 2] : MAXEVAL);
+        spent += nodes;
+        if (__atomic_load_n(&search_stop, __ATOMIC_RELAXED)) {
+            memcpy(principal_var, done, sizeof(done));
+            if (!fixed)
+                deadline_hit = deadline;
+            if (verbose)
+                fprintf(stderr, "Depth %d stopped at the %s\n", depth,
+                        fixed ? "node limit" : "deadline");
+            break;
+        }
+        scores[depth] = score;
+        clock_timings(depth);
+        if (principal_var[0] != 0) {
+            stable = principal_var[0] == best ? stable + 1 : 1;
+            best = principal_var[0];
+        }
+        if (verbose) {
+            print_stats();
+            print_search_stats();
+            print_pvar(bp, 0);
+            fputc('\n', stderr);
+        }
+        if (score >= MINWIN || score <= -MINWIN)
+            break;   /* the outcome is already decided */
+        if (depth >= maxdepth)
+            break;
+        if (fixed) {
+            if (search_fixed_nodes > 0 && spent >= search_fixed_nodes)
+                break;
+            continue;
+        }
+
+        int64_t elapsed = clock_now() - start;
+        int drop = depth > 2 ? scores[depth - 2] - score : 0;
+        if (verbose)
+            fprintf(stderr, "Depth %d...Time available: %.3f, Estimated time: %.3f\n",
+                    depth + 1, (double)(tl.hard - elapsed) / USEC_PER_SEC,
+                    (double)clock_estimate(depth) / USEC_PER_SEC);
+        if (depth >= 2 && clock_fixed == 0
+            && !clock_continue(&tl, elapsed, clock_estimate(depth), stable, drop))
+            break;
+    }
+    if (verbose && fixed)
+        fprintf(stderr, "Searched %ld nodes\n", spent);
+    search_deadline = 0;
+    search_node_limit = 0;
+    search_stop = 0;
+    return best;
+}
+
+/* Iterative deepening on the pondered position, until stopped or done. */
+static void *ponder_search(void *arg) {
+    (void)arg;
+    Player p = player_to_move(ponder.bp);
+    Move pv[MAXPLY + 1] = { 0 };
+    int scores[MAXPLY + 1];
+
+    for (int d = 1; d <= MAXPLY; d++) {
+        pthread_mutex_lock(&ponder.lock);
+        ponder.iterstart = clock_now();
+        pthread_mutex_unlock(&ponder.lock);
+        depth = d;
+        reset_stats();
+        clock_start();
+        int score = search_aspiration(ponder.bp, p, pv, d > 2 ? scores[d - 2] : MAXEVAL);
+        scores[d] = score;
+        if (__atomic_load_n(&search_stop, __ATOMIC_RELAXED))
+            break;
+
+        pthread_mutex_lock(&ponder.lock);
+        clock_timings(d);
+        memcpy(ponder.pv, pv, sizeof(ponder.pv));
+        ponder.depth = d;
+        pthread_cond_broadcast(&ponder.cond);
+        pthread_mutex_unlock(&ponder.lock);
+        if (score >= MINWIN || score <= -MINWIN)
+            break;
+    }
+    pthread_mutex_lock(&ponder.lock);
+    ponder.finished = 1;
+    pthread_cond_broadcast(&ponder.cond);
+    pthread_mutex_unlock(&ponder.lock);
+    return NULL;
+}
+
+/* Start pondering on the reply guess in the position on board bp. */
+static void ponder_start(Board *bp, Move guess) {
+    if (guess == 0 || game_over(bp))
+        return;
+    if (ponder.bp == NULL)
+        ponder.bp = newbd();
+    copybd(bp, ponder.bp);
+    ponder.key0 = search_key;
+    search_apply(ponder.bp, guess);
+    ponder.guess = guess;
+    ponder.hit = 0;
+    ponder.depth = 0;
+    ponder.finished = 0;
+    search_stop = 0;
+    if (pthread_create(&ponder.tid, NULL, ponder_search, NULL) != 0) {
+        search_key = ponder.key0;
+        return;
+    }
+    ponder.active = 1;
+}
+
+/* Stop the ponder search, if any, and wait for its thread to exit. */
+static void ponder_stop(void) {
+    if (!ponder.active)
+        return;
+    __atomic_store_n(&search_stop, 1, __ATOMIC_RELAXED);
+    pthread_join(ponder.tid, NULL);
+    search_stop = 0;
+    ponder.active = 0;
+    if (!ponder.hit)
+        search_key = ponder.key0;
+    ponder.hit = 0;
+}
+
+/*
+ * Our turn after a ponder hit: let the ponder search go on until the soft
+ * limit for this move has passed, or its iteration is not expected to finish
+ * within the hard limit, or the hard limit is reached.  Then stop it and return its
+ * best move, leaving its principal variation in principal_var.  Returns 0 if
+ * it has not completed an iteration, in which case think() should be used.
+ */
+static Move ponder_take(Board *bp) {
+    TimeLimits tl;
+    time_limits(bp, &tl);
+    int64_t start = clock_now();
+    int64_t end = start + tl.hard;
+
+    pthread_mutex_lock(&ponder.lock);
+    while (!ponder.finished && clock_now() < end) {
+        if (ponder.depth >= 2 && (clock_now() - start >= tl.soft
+                                  || ponder.iterstart + clock_estimate(ponder.depth) > end))
+            break;
+        /* Once an iteration is complete, wake at the soft limit rather than waiting for the next one. */
+        int64_t wake = ponder.depth >= 2 && start + tl.soft < end ? start + tl.soft : end;
+        struct timespec deadline = { .tv_sec = wake / USEC_PER_SEC, .tv_nsec = wake % USEC_PER_SEC * 1000 };
+        pthread_cond_timedwait(&ponder.cond, &ponder.lock, &deadline);
+    }
+    int d = ponder.depth;
+    memcpy(principal_var, ponder.pv, sizeof(ponder.pv));
+    pthread_mutex_unlock(&ponder.lock);
+    ponder_stop();
+
+    if (verbose)
+        fprintf(stderr, "Ponder hit: depth %d, %.3f seconds after our turn began\n",
+                d, (double)(clock_now() - start) / USEC_PER_SEC);
+    if (d == 0)
+        return 0;
+    searches++;
+    return principal_var[0];
+}
+
 void student_engine(Board *bp) {
 
 fprintf(stderr, "[engine] engine starts\n"); //ming
@@ -68,7 +330,22 @@ fprintf(stderr, "[engine] engine starts\n"); //ming
     /* Make stdout line-buffered so each line flushes to the parent immediately. */
     setvbuf(stdout, NULL, _IOLBF, 0);
 
-    
+    search_init();
+    if (egtb_path && egtb_open(egtb_path) < 0)
+        fprintf(stderr, "[engine] could not map endgame tablebase %s\n", egtb_path);
+    if (book_path && book_open(book_path) < 0)
+        fprintf(stderr, "[engine] could not map opening book %s\n", book_path);
+    if (nnue_path && nnue_open(nnue_path) < 0)
+        fprintf(stderr, "[engine] could not load network %s\n", nnue_path);
+    game_ply = move_number(bp);
+    clock_reset(game_ply);
+    make_history_room(bp, STACK_PLY);   /* print_pvar() plays out the PV on bp too */
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&ponder.cond, &attr);
+    pthread_condattr_destroy(&attr);
+
     char line[256];
 
     for (;;) {
@@ -87,7 +364,19 @@ fprintf(stderr, "[engine] engine starts\n"); //ming
 fprintf(stderr, "[engine] line 87\n"); //ming
 
 			Move m = parse_forwarded_move(bp, line);  /* or your existing wrapper */
-		    if (m != 0) apply(bp, m);
+		    if (m != 0) {
+		        clock_charge(player_to_move(bp));
+		        if (ponder.active && m == ponder.guess) {
+		            /* search_key already includes the guessed move */
+		            ponder.hit = 1;
+		            make_history_room(bp, 1 + STACK_PLY);
+		            apply(bp, m);
+		        } else {
+		            ponder_stop();
+		            search_apply(bp, m);
+		        }
+		        game_ply++;
+		    }
 		    /* Always ack so parent doesn’t wedge if we were conservative */
 		    if (write(STDOUT_FILENO, "ok\n", 3) != 3) {
 		        fprintf(stderr, "[engine] write(stdout) ack failed\n");
@@ -97,22 +386,37 @@ fprintf(stderr, "[engine] line 87\n"); //ming
             /* Our turn: compute and emit exactly one legal move to parent's stdout pipe */
             fprintf(stderr, "[engine] searching (iterative deepening)...\n");
 
-            Player me = player_to_move(bp);
-            (void)bestmove(bp, me, 0, principal_var, -MAXEVAL, +MAXEVAL);
-            Move best = principal_var[0];
-            if (best == 0) {
-                depth = 1;
-                (void)bestmove(bp, me, 0, principal_var, -MAXEVAL, +MAXEVAL);
-                best = principal_var[0];
-                if (best == 0) { fprintf(stderr, "[engine] ERROR: no move\n"); continue; }
+            Move best = book_move(bp);
+            if (best != 0) {
+                /* No principal variation, so no pondering on a book move */
+                ponder_stop();
+                memset(principal_var, 0, (MAXPLY + 1) * sizeof(Move));
+                if (verbose)
+                    fprintf(stderr, "Book move\n");
+            } else {
+                best = ponder.hit ? ponder_take(bp) : 0;
+                ponder_stop();
+                if (best == 0)
+                    best = think(bp);
             }
+            if (best == 0) { fprintf(stderr, "[engine] ERROR: no move\n"); continue; }
 
             /* Emit EXACTLY ONE line to stdout */
-            print_move(bp, best, stdout);   /* prints "<move>\n" */
-            fflush(stdout);                  /* make sure it leaves the pipe now */
+            print_move(bp, best, stdout);   /* prints "<move>" */
+            fprintf(stdout, "\n");          /* add the required newline */
+            fflush(stdout);                 /* make sure it leaves the pipe now */
+            if (verbose && deadline_hit) {
+                fprintf(stderr, "Move sent %.3f ms after the deadline\n",
+                        (clock_now() - deadline_hit) / 1000.0);
+                deadline_hit = 0;
+            }
 
-            apply(bp, best);
+            clock_charge(player_to_move(bp));
+            search_apply(bp, best);
+            game_ply++;
             fprintf(stderr, "[engine] played.\n");
+            if (search_fixed_depth == 0 && search_fixed_nodes == 0)
+                ponder_start(bp, principal_var[1]);   /* it would make the next search depend on timing */
             continue;
         } else {
             /* Unknown control line: ignore. */
@@ -0,0 +1,115 @@
+/*
+ * Reentrant move generation and evaluation over the library board.
+ */
+
+#include <string.h>
+
+#include "board.h"
+#include "movegen.h"
+
+/* The six neighbour directions, in the same order as rdirect[]/cdirect[]. */
+static const int rdir[6] = { 0, -1, -1,  0,  1, 1 };
+static const int cdir[6] = { 1,  1,  0, -1, -1, 0 };
+
+/*
+ * Breadth-first search over jump chains from one piece.  Landing cells are
+ * marked VISITED so that each is reported once, and restored afterwards; a
+ * hop onto a cell already marked is skipped, and counted in *hops.
+ */
+static int jumps_from(Board *bp, Player p, int pos, Move *list, long *hops) {
+    int frontier[BOARD_SIZE * BOARD_SIZE], next[BOARD_SIZE * BOARD_SIZE];
+    int landed[BOARD_SIZE * BOARD_SIZE];
+    int nf = 0, nl = 0, n = 0;
+    Move origin = (p << 16) | (pos << 8);
+
+    frontier[nf++] = pos;
+    while (nf) {
+        int nn = 0;
+        for (int i = 0; i < nf; i++) {
+            int r = POS_ROW(frontier[i]), c = POS_COL(frontier[i]);
+            for (int d = 0; d < 6; d++) {
+                if (!IS_PIECE(CELL(bp, r + rdir[d], c + cdir[d])))
+                    continue;
+                int r2 = r + 2 * rdir[d], c2 = c + 2 * cdir[d];
+                if (CELL(bp, r2, c2) != EMPTY) {
+                    if (CELL(bp, r2, c2) == VISITED && hops)
+                        (*hops)++;
+                    continue;
+                }
+                CELL(bp, r2, c2) = VISITED;
+                landed[nl++] = next[nn++] = (r2 << 4) | c2;
+                list[n++] = origin | (r2 << 4) | c2;
+            }
+        }
+        for (int i = 0; i < nn; i++)
+            frontier[i] = next[i];
+        nf = nn;
+    }
+    for (int i = 0; i < nl; i++)
+        CELL(bp, POS_ROW(landed[i]), POS_COL(landed[i])) = EMPTY;
+    return n;
+}
+
+static int steps_from(Board *bp, Player p, int pos, Move *list) {
+    int r = POS_ROW(pos), c = POS_COL(pos);
+    int n = 0;
+    for (int d = 0; d < 6; d++) {
+        int r2 = r + rdir[d], c2 = c + cdir[d];
+        int v = CELL(bp, r2, c2);
+        if (v != EMPTY) {
+            /* Only an opponent piece next to or in our goal may be swapped with. */
+            if (!IS_PIECE(v) || PIECE_PLAYER(v) == p)
+                continue;
+            if (p == X ? r2 + c2 < SWAP_X : r2 + c2 > SWAP_O)
+                continue;
+        }
+        list[n++] = (p << 16) | (pos << 8) | (r2 << 4) | c2;
+    }
+    return n;
+}
+
+int generate_moves(Board *bp, Move *list, long *hops) {
+    Player p = bp->player;
+    int n = 0;
+    for (int i = 0; i < NPIECES; i++) {
+        n += jumps_from(bp, p, bp->pos[p][i], list + n, hops);
+        n += steps_from(bp, p, bp->pos[p][i], list + n);
+    }
+    return n;
+}
+
+int generate_jumps(Board *bp, Move *list, long *hops) {
+    Player p = bp->player;
+    int n = 0;
+    for (int i = 0; i < NPIECES; i++)
+        n += jumps_from(bp, p, bp->pos[p][i], list + n, hops);
+    return n;
+}
+
+int is_legal(Board *bp, Move m) {
+    Move list[MAXPOSMOVES];
+    int n = generate_moves(bp, list, NULL);
+    for (int i = 0; i < n; i++)
+        if (list[i] == m)
+            return 1;
+    return 0;
+}
+
+void make_history_room(Board *bp, int n) {
+    int drop = bp->nhist + n - MAXHIST;
+    if (drop <= 0)
+        return;
+    memmove(bp->history, bp->history + drop, (bp->nhist - drop) * sizeof(Move));
+    bp->nhist -= drop;
+}
+
+int evaluate(Board *bp, Player p) {
+    int s;
+    if (bp->progress[X] == WINPROGRESS)
+        s = MAXEVAL - 1;
+    else if (bp->progress[O] == WINPROGRESS)
+        s = -(MAXEVAL - 1);
+    else
+        s = (bp->progress[X] - bp->progress[O]) * 100 + bp->center[X] - bp->center[O];
+    return p == X ? s : -s;
+}
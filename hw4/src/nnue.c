@@ -0,0 +1,227 @@
+/*
+ * Efficiently updatable neural network evaluation.
+ *
+ * The weights file is a header followed by the arrays of struct Net in
+ * order, little-endian, without padding between them.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "movegen.h"
+#include "nnue.h"
+#include "search.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86 1
+#endif
+
+#define NNUE_MAGIC "CCNN"
+#define NNUE_VERSION 1
+#define ACT_MAX 127                       // Activations are clamped to 0..ACT_MAX
+
+const char *nnue_path;
+int nnue_ready;
+
+typedef struct NnueHeader {
+    char magic[4];                        // NNUE_MAGIC
+    uint32_t version;                     // NNUE_VERSION
+    uint32_t inputs, h1, h2, shift;       // NNUE_INPUTS, NNUE_H1, NNUE_H2, NNUE_SHIFT
+} NnueHeader;
+
+static struct Net {
+    int16_t w1[NNUE_INPUTS][NNUE_H1];     // Accumulator column of each input
+    int16_t b1[NNUE_H1];
+    int8_t w2[NNUE_H2][NNUE_H1] __attribute__((aligned(32)));
+    int32_t b2[NNUE_H2];
+    int8_t w3[NNUE_H2];
+    int32_t b3;
+} net __attribute__((aligned(32)));
+
+/* Second layer: out[j] = b2[j] + sum of w2[j][i] * x[i]. */
+typedef void (*Layer2)(const uint8_t *x, int32_t *out);
+
+static void layer2_scalar(const uint8_t *x, int32_t *out) {
+    for (int j = 0; j < NNUE_H2; j++) {
+        int32_t s = net.b2[j];
+        for (int i = 0; i < NNUE_H1; i++)
+            s += net.w2[j][i] * x[i];
+        out[j] = s;
+    }
+}
+
+#ifdef HAVE_X86
+/* Byte products of x (0..127) and a row (-128..127) fit in int16 pairwise, so maddubs cannot saturate. */
+__attribute__((target("avx2")))
+static void layer2_avx2(const uint8_t *x, int32_t *out) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    __m256i x0 = _mm256_load_si256((const __m256i *)x);
+    __m256i x1 = _mm256_load_si256((const __m256i *)(x + 32));
+    for (int j = 0; j < NNUE_H2; j++) {
+        __m256i p0 = _mm256_maddubs_epi16(x0, _mm256_load_si256((const __m256i *)net.w2[j]));
+        __m256i p1 = _mm256_maddubs_epi16(x1, _mm256_load_si256((const __m256i *)(net.w2[j] + 32)));
+        __m256i s = _mm256_madd_epi16(_mm256_add_epi16(p0, p1), ones);
+        __m128i h = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+        h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(1, 0, 3, 2)));
+        h = _mm_add_epi32(h, _mm_shuffle_epi32(h, _MM_SHUFFLE(2, 3, 0, 1)));
+        out[j] = net.b2[j] + _mm_cvtsi128_si32(h);
+    }
+}
+#endif
+
+_Static_assert(NNUE_H1 == 64, "layer2_avx2 handles exactly 64 inputs");
+
+static Layer2 layer2 = layer2_scalar;
+
+static void select_kernel(void) {
+    layer2 = layer2_scalar;
+#ifdef HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        layer2 = layer2_avx2;
+#endif
+}
+
+_Static_assert(NNUE_INPUTS == 2 * BOARD_SIZE * BOARD_SIZE, "one input per player and cell");
+
+/* Input number of a piece of player p on a cell (row << 4 | col). */
+static int input(Player p, int pos) {
+    return p * BOARD_SIZE * BOARD_SIZE + POS_ROW(pos) * BOARD_SIZE + POS_COL(pos);
+}
+
+/* Separate loops without aliasing, so that they vectorize. */
+static void add(int16_t *restrict v, const int16_t *restrict w) {
+    for (int i = 0; i < NNUE_H1; i++)
+        v[i] += w[i];
+}
+
+static void sub(int16_t *restrict v, const int16_t *restrict w) {
+    for (int i = 0; i < NNUE_H1; i++)
+        v[i] -= w[i];
+}
+
+static void add_column(NnueAcc *a, int in, int sign) {
+    if (sign > 0)
+        add(a->v, net.w1[in]);
+    else
+        sub(a->v, net.w1[in]);
+}
+
+void nnue_reset(NnueAcc *a, Board *bp) {
+    memcpy(a->v, net.b1, sizeof(a->v));
+    for (int p = 0; p < 2; p++)
+        for (int i = 0; i < NPIECES; i++)
+            add_column(a, input(p, bp->pos[p][i]), 1);
+}
+
+void nnue_move(NnueAcc *a, Board *bp, Move m, int sign) {
+    int from = (m >> 8) & 0xff, to = m & 0xff;
+    if (from == to)
+        return;
+    Player p = bp->player;
+    add_column(a, input(p, from), -sign);
+    add_column(a, input(p, to), sign);
+    int v = CELL(bp, POS_ROW(to), POS_COL(to));
+    if (IS_PIECE(v)) {                    /* swap with an opponent piece */
+        add_column(a, input(PIECE_PLAYER(v), to), -sign);
+        add_column(a, input(PIECE_PLAYER(v), from), sign);
+    }
+}
+
+static int clamp(int x) {
+    return x < 0 ? 0 : x > ACT_MAX ? ACT_MAX : x;
+}
+
+int nnue_evaluate(const NnueAcc *a, Player p) {
+    uint8_t x[NNUE_H1] __attribute__((aligned(32)));
+    int32_t h[NNUE_H2];
+    for (int i = 0; i < NNUE_H1; i++)
+        x[i] = clamp(a->v[i]);
+    layer2(x, h);
+    int32_t out = net.b3;
+    for (int j = 0; j < NNUE_H2; j++)
+        out += net.w3[j] * clamp(h[j] >> NNUE_SHIFT);
+    return p == X ? out : -out;
+}
+
+int nnue_evaluate_full(Board *bp, Player p) {
+    int e = evaluate(bp, p);
+    if (e >= WINEVAL || e <= -WINEVAL)
+        return e;
+    NnueAcc a;
+    nnue_reset(&a, bp);
+    return nnue_evaluate(&a, p);
+}
+
+int nnue_open(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+        return -1;
+    NnueHeader h;
+    int ok = fread(&h, sizeof(h), 1, f) == 1
+        && memcmp(h.magic, NNUE_MAGIC, 4) == 0 && h.version == NNUE_VERSION
+        && h.inputs == NNUE_INPUTS && h.h1 == NNUE_H1 && h.h2 == NNUE_H2 && h.shift == NNUE_SHIFT
+        && fread(net.w1, sizeof(net.w1), 1, f) == 1
+        && fread(net.b1, sizeof(net.b1), 1, f) == 1
+        && fread(net.w2, sizeof(net.w2), 1, f) == 1
+        && fread(net.b2, sizeof(net.b2), 1, f) == 1
+        && fread(net.w3, sizeof(net.w3), 1, f) == 1
+        && fread(&net.b3, sizeof(net.b3), 1, f) == 1
+        && fgetc(f) == EOF;
+    fclose(f);
+    if (!ok)
+        return -1;
+    select_kernel();
+    nnue_ready = 1;
+    return 0;
+}
+
+/*
+ * The classic evaluation is linear in the inputs:
+ *   100 * (progress[X] - progress[O]) + center[X] - center[O]
+ * where progress[X] = sum of row + col - 20, progress[O] = sum of
+ * 16 - row - col - 20, and center[] = 32 - sum of |row - col|.  Four
+ * accumulator units hold the two progress sums and the two sums of
+ * |row - col|, all within 0..127; the second layer passes them through, and
+ * the output layer weighs them.  The straggler penalties are not part of
+ * the network; the search adds them to its score.
+ */
+int nnue_write_default(const char *path) {
+    struct Net *n = calloc(1, sizeof(*n));
+    if (n == NULL)
+        return -1;
+    for (int r = 0; r < BOARD_SIZE; r++) {
+        for (int c = 0; c < BOARD_SIZE; c++) {
+            int pos = (r << 4) | c;
+            n->w1[input(X, pos)][0] = r + c;
+            n->w1[input(O, pos)][1] = 2 * (BOARD_SIZE - 1) - (r + c);
+            n->w1[input(X, pos)][2] = abs(r - c);
+            n->w1[input(O, pos)][3] = abs(r - c);
+        }
+    }
+    n->b1[0] = n->b1[1] = -20;
+    for (int k = 0; k < 4; k++)
+        n->w2[k][k] = 1 << NNUE_SHIFT;
+    n->w3[0] = 100;
+    n->w3[1] = -100;
+    n->w3[2] = -1;
+    n->w3[3] = 1;
+
+    NnueHeader h = { NNUE_MAGIC, NNUE_VERSION, NNUE_INPUTS, NNUE_H1, NNUE_H2, NNUE_SHIFT };
+    FILE *f = fopen(path, "wb");
+    int ok = f != NULL
+        && fwrite(&h, sizeof(h), 1, f) == 1
+        && fwrite(n->w1, sizeof(n->w1), 1, f) == 1
+        && fwrite(n->b1, sizeof(n->b1), 1, f) == 1
+        && fwrite(n->w2, sizeof(n->w2), 1, f) == 1
+        && fwrite(n->b2, sizeof(n->b2), 1, f) == 1
+        && fwrite(n->w3, sizeof(n->w3), 1, f) == 1
+        && fwrite(&n->b3, sizeof(n->b3), 1, f) == 1;
+    if (f != NULL && fclose(f) != 0)
+        ok = 0;
+    free(n);
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,912 @@
+/*
+ * Alpha/beta search with a transposition table.
+ *
+ * Chinese-checkers jump chains reach the same position through many move
+ * orders, so the search remembers the result for every position it has
+ * searched and reuses it when the position comes up again.
+ *
+ * With search_threads > 1 the search runs Lazy SMP style: helper threads
+ * search the same root on private copies of the board, at staggered depths,
+ * and share only the transposition table.  Their results reach the main
+ * thread through the table; the main thread's PV is the one reported.
+ *
+ * With search_driver == SEARCH_YBWC the threads instead divide up the tree
+ * (Young Brothers Wait).  A node searches its eldest child itself; if that
+ * does not cut off and enough depth remains, the node becomes a split point
+ * whose younger brothers idle threads in the pool take ("steal") one at a
+ * time, while the owner keeps taking them too.  A fail high at a split point
+ * sets its cutoff flag, and every thread working anywhere below it notices
+ * on its next node and unwinds.
+ */
+
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "ccheck.h"
+#include "clock.h"
+#include "egtb.h"
+#include "movegen.h"
+#include "nnue.h"
+#include "search.h"
+#include "tt.h"
+
+uint64_t search_key;
+int search_threads = 1;
+int search_driver = SEARCH_LAZY;
+int search_stop;
+int64_t search_deadline;
+long search_node_limit;
+int search_fixed_depth;
+long search_fixed_nodes;
+int quiesce_ply = QUIESCE_PLY;
+double lmr_base = LMR_BASE;
+double lmr_divisor = LMR_DIVISOR;
+int straggler_weight = STRAGGLER_WEIGHT;
+
+#define SPLIT_MIN_DEPTH 3                 // Least remaining depth at which a node is split
+#define ASPIRATION_WINDOW 50              // Half-width of the first aspiration window
+
+/* Late move reductions (see init_reductions()). */
+#define LMR_MIN_DEPTH 3                   // Least remaining depth at which moves are reduced
+#define LMR_FULL_MOVES 3                  // Moves searched to full depth before reducing
+#define LMR_MAX_MOVE 63                   // Moves beyond this are reduced as this one
+
+static int reductions[MAXPLY + 1][LMR_MAX_MOVE + 1];
+
+/* Straggler penalty of a piece of each player on each cell, by row << 4 | col (see init_eval()). */
+static int straggle_tab[2][256];
+
+/* Move ordering tables are indexed by the from and to cells of a move. */
+#define NCELLS (BOARD_SIZE * BOARD_SIZE)
+#define CELLNO(x) (POS_ROW(x) * BOARD_SIZE + POS_COL(x))
+#define FROM_CELL(m) CELLNO((m) >> 8)
+#define TO_CELL(m) CELLNO(m)
+#define HISTORY_MAX (1 << 16)             // History scores are halved on reaching this
+
+/* Ordering scores of moves tried ahead of the rest (which score below 2^21). */
+#define ORDER_HASH INT_MAX
+#define ORDER_KILLER (INT_MAX - 2)        // Less 1 for the second killer
+#define ORDER_COUNTER (INT_MAX - 3)
+
+/* What make() changed, so that unmake() can take it back without recomputing it. */
+typedef struct UndoRecord {
+    Move m;                               // The move: player, from and to cells
+    uint64_t key;                         // Change to the Zobrist key
+    int straggle[2];                      // Changes to the straggler penalties
+} UndoRecord;
+
+/* A node whose younger brothers are open to other threads (YBWC). */
+typedef struct SplitPoint {
+    struct SplitPoint *parent;            // Split point the owner was working under
+    struct SplitPoint *next;              // Link in the list of open split points
+    Move path[MAXPLY];                    // Moves from the search root to the node
+    Player p;                             // Player to move
+    int ply;                              // Ply of the node
+    int d;                                // Remaining depth at the node
+    int pvnode;                           // Whether the node has an open window
+    int beta;
+    Move *list;                           // Moves of the node (on the owner's move stack)
+    int *score;                           // Ordering scores of list (on the owner's score stack)
+    int nmoves;                           // Number of moves in list
+    /* The fields below are protected by pool_lock. */
+    int nextmove;                         // Index of the next move to hand out
+    int alpha;                            // Best bound so far
+    int best;                             // Best score so far
+    Move bestm;                           // Move with the best score
+    Move pv[MAXPLY + 2];                  // PV through bestm, if it raised alpha
+    int pvlen;                            // Length of pv, or -1 if not set here
+    int workers;                          // Threads other than the owner searching a move
+    int cutoff;                           // Set when a move fails high (read without lock)
+} SplitPoint;
+
+/* Per-thread search state. */
+typedef struct SearchThread {
+    int id;                               // 0 for the main thread
+    Board *bp;                            // Board being searched (private to the thread)
+    uint64_t key;                         // Zobrist key of *bp
+    int straggle[2];                      // Sum of straggle_tab[] over each player's pieces on *bp
+    NnueAcc acc;                          // Network accumulator for *bp (with -n)
+    UndoRecord made[STACK_PLY];           // Moves made on *bp since the search root
+    int height;                           // Number of entries in made
+    int depth;                            // Depth of the search from the root
+    long nodes;                           // Nodes visited
+    long cutoffs;                         // Nodes that failed high
+    long firstcutoffs;                    // Nodes that failed high on the first move
+    long tbhits;                          // Nodes scored by the endgame tablebase
+    long repeathops;                      // Hops onto landing cells already listed, skipped by the generator
+    /* Triangular principal variation table: pvtab[ply] is the PV from ply on. */
+    Move pvtab[MAXPLY + 2][MAXPLY + 2];
+    int pvlen[MAXPLY + 2];
+    /* Principal variation of the previous iteration, tried first along its path. */
+    Move prevpv[MAXPLY];
+    int prevlen;
+    SplitPoint *sp;                       // Split point whose move is being searched, if any
+    /* Move ordering: moves that recently caused cutoffs. */
+    Move killers[MAXPLY + 2][2];          // Last two cutoff moves at each ply
+    int history[2][NCELLS][NCELLS];       // Cutoff counts weighted by depth, by player, from, to
+    Move counter[2][NCELLS][NCELLS];      // Last cutoff reply to a move by player, from, to
+    /* Move stack: the moves of the node at each ply, and their ordering scores. */
+    Move moves[STACK_PLY][MAXPOSMOVES];
+    int scores[STACK_PLY][MAXPOSMOVES];
+} SearchThread;
+
+static SearchThread threads[MAXTHREADS];
+static int stop_helpers;                  // Set when the main thread has finished
+
+/* Statistics since reset_search_stats(), summed over threads. */
+static long total_cutoffs;
+static long total_firstcutoffs;
+static long total_researches;             // Aspiration windows that failed
+static long total_tbhits;
+static long total_repeathops;
+
+/* YBWC thread pool: threads[1..pool_size] wait here for open split points. */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t pool_tids[MAXTHREADS];
+static int pool_size;
+static int pool_quit;
+static SplitPoint *open_splits;           // Split points with moves left to hand out
+
+/*
+ * Fill in the reduction table: a move searched with a null window at a node
+ * with d ply left, after LMR_FULL_MOVES or more others, is searched
+ * lmr_base + ln(d) * ln(i) / lmr_divisor ply less deep, but at least one ply
+ * deep.  A divisor of 0 turns reductions off.
+ */
+static void init_reductions(void) {
+    for (int d = 0; d <= MAXPLY; d++) {
+        for (int i = 0; i <= LMR_MAX_MOVE; i++) {
+            int r = 0;
+            if (lmr_divisor > 0 && d >= LMR_MIN_DEPTH && i >= LMR_FULL_MOVES)
+                r = (int)(lmr_base + log(d) * log(i) / lmr_divisor);
+            if (r > d - 2) r = d - 2;
+            reductions[d][i] = r < 0 ? 0 : r;
+        }
+    }
+}
+
+/*
+ * Fill in the straggler penalties.  The board keeps running totals of how far
+ * each player's pieces have advanced (progress[]), which the evaluation reads
+ * in constant time, but those say nothing of how the advance is shared out:
+ * a piece left behind costs many moves at the end of the game, when there
+ * are no more pieces to jump over.  So each piece also costs
+ * straggler_weight / 16 times the square of its distance from home, in
+ * diagonals; the totals are kept up to date move by move, like the key.
+ */
+static void init_eval(void) {
+    for (int r = 0; r < BOARD_SIZE; r++) {
+        for (int c = 0; c < BOARD_SIZE; c++) {
+            int dx = 2 * (BOARD_SIZE - 1) - (r + c), dO = r + c;
+            straggle_tab[X][(r << 4) | c] = straggler_weight * dx * dx / 16;
+            straggle_tab[O][(r << 4) | c] = straggler_weight * dO * dO / 16;
+        }
+    }
+}
+
+void search_init(void) {
+    search_key = 0;
+    init_reductions();
+    init_eval();
+    if (quiesce_ply < 0) quiesce_ply = 0;
+    if (quiesce_ply > MAXPLY) quiesce_ply = MAXPLY;
+    if (search_threads < 1) search_threads = 1;
+    if (search_threads > MAXTHREADS) search_threads = MAXTHREADS;
+    if (tt_init(hash_mb) < 0)
+        fprintf(stderr, "[search] could not allocate %d MB hash table\n", hash_mb);
+}
+
+void reset_search_stats(void) {
+    total_cutoffs = 0;
+    total_firstcutoffs = 0;
+    total_researches = 0;
+    total_tbhits = 0;
+    total_repeathops = 0;
+}
+
+void print_search_stats(void) {
+    fprintf(stderr, "Cutoffs: %ld, First move: %.1f%%, Re-searches: %ld, Tablebase hits: %ld, "
+            "Repeated hops skipped: %ld\n",
+            total_cutoffs, total_cutoffs ? 100.0 * total_firstcutoffs / total_cutoffs : 0.0,
+            total_researches, total_tbhits, total_repeathops);
+}
+
+static void clear_counts(SearchThread *t) {
+    t->nodes = 0;
+    t->cutoffs = 0;
+    t->firstcutoffs = 0;
+    t->tbhits = 0;
+    t->repeathops = 0;
+}
+
+static void add_counts(SearchThread *t, SearchThread *from) {
+    t->nodes += from->nodes;
+    t->cutoffs += from->cutoffs;
+    t->firstcutoffs += from->firstcutoffs;
+    t->tbhits += from->tbhits;
+    t->repeathops += from->repeathops;
+}
+
+/* Thread i's context, with its private board allocated on first use. */
+static SearchThread *thread(int i) {
+    SearchThread *t = &threads[i];
+    t->id = i;
+    if (!t->bp) t->bp = newbd();
+    return t;
+}
+
+/*
+ * Give thread h its own copy of the main thread's board at the search root.
+ * This is the only copy of a board a search makes: below the root, boards
+ * change only by make() and unmake().
+ */
+static void set_root(SearchThread *h, SearchThread *t) {
+    copybd(t->bp, h->bp);
+    h->key = t->key;
+    memcpy(h->straggle, t->straggle, sizeof(h->straggle));
+    h->acc = t->acc;
+    h->height = 0;
+}
+
+void search_apply(Board *bp, Move m) {
+    search_key ^= tt_move_key(bp, m);
+    make_history_room(bp, 1 + STACK_PLY);
+    apply(bp, m);
+}
+
+void search_undo(Board *bp, Move m) {
+    undo(bp);
+    search_key ^= tt_move_key(bp, m);
+}
+
+/* Recompute the straggler penalties (and network accumulator) of a thread's board from scratch. */
+static void eval_reset(SearchThread *t) {
+    for (int p = 0; p < 2; p++) {
+        t->straggle[p] = 0;
+        for (int i = 0; i < NPIECES; i++)
+            t->straggle[p] += straggle_tab[p][t->bp->pos[p][i]];
+    }
+    if (nnue_ready)
+        nnue_reset(&t->acc, t->bp);
+}
+
+/* Record in u and add the change u->m makes to the penalties (and accumulator); bp is before the move. */
+static void eval_move(SearchThread *t, UndoRecord *u) {
+    unsigned from = (u->m >> 8) & 0xff, to = u->m & 0xff;
+    Player p = t->bp->player;
+    u->straggle[p] = straggle_tab[p][to] - straggle_tab[p][from];
+    u->straggle[1 - p] = 0;
+    int v = CELL(t->bp, POS_ROW(to), POS_COL(to));
+    if (from != to && IS_PIECE(v)) {     /* swap with an opponent piece */
+        Player q = PIECE_PLAYER(v);
+        u->straggle[q] = straggle_tab[q][from] - straggle_tab[q][to];
+    }
+    t->straggle[X] += u->straggle[X];
+    t->straggle[O] += u->straggle[O];
+    if (nnue_ready)
+        nnue_move(&t->acc, t->bp, u->m, 1);
+}
+
+/*
+ * Static evaluation: the board's own, or the network's if one was loaded,
+ * less the side to move's straggler penalty plus the other's.  The network
+ * stands in for evaluate() only; the straggler term is added to either.
+ */
+static int eval_node(SearchThread *t, Player p) {
+    int e = evaluate(t->bp, p);
+    if (e >= WINEVAL || e <= -WINEVAL)
+        return e;
+    if (nnue_ready)
+        e = nnue_evaluate(&t->acc, p);
+    return e + t->straggle[1 - p] - t->straggle[p];
+}
+
+static void make(SearchThread *t, Move m) {
+    UndoRecord *u = &t->made[t->height++];
+    u->m = m;
+    u->key = tt_move_key(t->bp, m);
+    t->key ^= u->key;
+    eval_move(t, u);
+    apply(t->bp, m);
+}
+
+/* Take back the last move made, from its undo record. */
+static void unmake(SearchThread *t) {
+    UndoRecord *u = &t->made[--t->height];
+    undo(t->bp);
+    t->key ^= u->key;
+    t->straggle[X] -= u->straggle[X];
+    t->straggle[O] -= u->straggle[O];
+    if (nnue_ready)
+        nnue_move(&t->acc, t->bp, u->m, -1);
+}
+
+/* Win scores depend on the ply at which they were found; store them relative to the node. */
+static int score_to_tt(int s, int ply) {
+    if (s >= MINWIN) return s + ply;
+    if (s <= -MINWIN) return s - ply;
+    return s;
+}
+
+static int score_from_tt(int s, int ply) {
+    if (s >= MINWIN) return s - ply;
+    if (s <= -MINWIN) return s + ply;
+    return s;
+}
+
+/* Forward progress of a move, measured toward the far corner for X. */
+static int progress(Move m) {
+    return (row_to(m) - row_from(m)) + (col_to(m) - col_from(m));
+}
+
+/* The move that led to the position on the board, or 0 at the start. */
+static Move last_move(Board *bp) {
+    return bp->nhist ? bp->history[bp->nhist - 1] : 0;
+}
+
+/*
+ * Give each move an ordering score: the hash move first, then the killers for
+ * the ply, then the move that last refuted the opponent's previous move, then
+ * the others, the more forward ahead, with ties broken by history score.
+ */
+static void score_moves(SearchThread *t, Player p, int ply, Move hashmove,
+                        Move *list, int *score, int n) {
+    Move prev = last_move(t->bp);
+    Move counter = prev ? t->counter[1 - p][FROM_CELL(prev)][TO_CELL(prev)] : 0;
+    for (int i = 0; i < n; i++) {
+        Move m = list[i];
+        if (m == hashmove)
+            score[i] = ORDER_HASH;
+        else if (m == t->killers[ply][0])
+            score[i] = ORDER_KILLER;
+        else if (m == t->killers[ply][1])
+            score[i] = ORDER_KILLER - 1;
+        else if (m == counter)
+            score[i] = ORDER_COUNTER;
+        else
+            score[i] = (p == X ? progress(m) : -progress(m)) * HISTORY_MAX
+                       + t->history[p][FROM_CELL(m)][TO_CELL(m)];
+    }
+}
+
+/*
+ * Move the best-scoring of list[i..n-1] to list[i].  Cutoffs usually come
+ * from one of the first few moves, so selecting moves one at a time costs
+ * less than sorting the whole list.
+ */
+static void pick_move(Move *list, int *score, int i, int n) {
+    int b = i;
+    for (int j = i + 1; j < n; j++)
+        if (score[j] > score[b])
+            b = j;
+    Move m = list[i];
+    int sc = score[i];
+    list[i] = list[b];
+    score[i] = score[b];
+    list[b] = m;
+    score[b] = sc;
+}
+
+static void age_history(SearchThread *t) {
+    for (int p = 0; p < 2; p++)
+        for (int i = 0; i < NCELLS; i++)
+            for (int j = 0; j < NCELLS; j++)
+                t->history[p][i][j] /= 2;
+}
+
+/* Record that move m by p failed high at ply, with d ply left to search. */
+static void note_cutoff(SearchThread *t, Player p, int ply, int d, Move m) {
+    if (t->killers[ply][0] != m) {
+        t->killers[ply][1] = t->killers[ply][0];
+        t->killers[ply][0] = m;
+    }
+    int *h = &t->history[p][FROM_CELL(m)][TO_CELL(m)];
+    *h += d * d;
+    if (*h >= HISTORY_MAX)
+        age_history(t);
+    Move prev = last_move(t->bp);
+    if (prev)
+        t->counter[1 - p][FROM_CELL(prev)][TO_CELL(prev)] = m;
+}
+
+/*
+ * Whether the result of the search a thread is doing is no longer wanted:
+ * the whole search has been stopped, the main thread has finished (Lazy SMP),
+ * or one of the split points it is working under has failed high (YBWC).
+ */
+static int aborted(SearchThread *t) {
+    if (__atomic_load_n(&search_stop, __ATOMIC_RELAXED))
+        return 1;
+    if ((t->nodes & (STOP_CHECK_NODES - 1)) == 0) {
+        int64_t deadline = __atomic_load_n(&search_deadline, __ATOMIC_RELAXED);
+        if (deadline && clock_now() >= deadline) {
+            __atomic_store_n(&search_stop, 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+    }
+    if (t->id == 0 && search_node_limit && nodes + t->nodes >= search_node_limit) {
+        __atomic_store_n(&search_stop, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+    if (t->id && __atomic_load_n(&stop_helpers, __ATOMIC_RELAXED))
+        return 1;
+    for (SplitPoint *sp = t->sp; sp; sp = sp->parent)
+        if (__atomic_load_n(&sp->cutoff, __ATOMIC_RELAXED))
+            return 1;
+    return 0;
+}
+
+static int alphabeta(SearchThread *t, Player p, int ply, int d, int onpv, int alpha, int beta);
+
+/*
+ * Search a move other than the first at a node with d ply left, after it has
+ * been made: with a null window (reduced by r ply), then again at full depth
+ * if a reduced search beats alpha, then with the full window only if it still
+ * beats alpha (principal variation search).  Returns the score for p.
+ */
+static int search_later(SearchThread *t, Player p, int ply, int d, int r, int alpha, int beta) {
+    int s = -alphabeta(t, 1 - p, ply + 1, d - 1 - r, 0, -alpha - 1, -alpha);
+    if (r && s > alpha && !aborted(t))
+        s = -alphabeta(t, 1 - p, ply + 1, d - 1, 0, -alpha - 1, -alpha);
+    if (s > alpha && s < beta && !aborted(t))
+        s = -alphabeta(t, 1 - p, ply + 1, d - 1, 0, -beta, -alpha);
+    return s;
+}
+
+/*
+ * How far to reduce the i-th move (in order) at a node with d ply left.  Late
+ * moves are reduced, unless the node is on the PV or the move is special (the
+ * hash move, a killer or the counter move, by its ordering score).
+ */
+static int reduction(int pvnode, int d, int i, int order) {
+    if (pvnode || order >= ORDER_COUNTER)
+        return 0;
+    return reductions[d][i < LMR_MAX_MOVE ? i : LMR_MAX_MOVE];
+}
+
+/*
+ * Take moves from a split point and search them until none are left or the
+ * split point (or one above it) fails high.  Called with pool_lock held; the
+ * thread's board must be in the split point's position.
+ */
+static void sp_search(SearchThread *t, SplitPoint *sp) {
+    SplitPoint *outer = t->sp;
+    t->sp = sp;
+    while (sp->nextmove < sp->nmoves && !aborted(t)) {
+        int i = sp->nextmove++;
+        Move m = sp->list[i];
+        int alpha = sp->alpha;
+        int r = reduction(sp->pvnode, sp->d, i, sp->score[i]);
+        pthread_mutex_unlock(&pool_lock);
+        make(t, m);
+        int s = search_later(t, sp->p, sp->ply, sp->d, r, alpha, sp->beta);
+        unmake(t);
+        pthread_mutex_lock(&pool_lock);
+        if (aborted(t))
+            break;
+
+        if (s > sp->best) {
+            sp->best = s;
+            sp->bestm = m;
+            if (s > sp->alpha || sp->ply == 0) {
+                sp->pv[0] = m;
+                memcpy(&sp->pv[1], t->pvtab[sp->ply + 1], t->pvlen[sp->ply + 1] * sizeof(Move));
+                sp->pvlen = t->pvlen[sp->ply + 1] + 1;
+            }
+            if (s > sp->alpha) sp->alpha = s;
+            if (s >= sp->beta) {
+                __atomic_store_n(&sp->cutoff, 1, __ATOMIC_RELAXED);
+                t->cutoffs++;
+                note_cutoff(t, sp->p, sp->ply, sp->d, m);
+            }
+        }
+    }
+    t->sp = outer;
+}
+
+/*
+ * Open the moves list[1..n-1] of the node at ply, with d ply left, to the
+ * pool, search them together with any threads that join, and wait for those
+ * threads to finish.  Their ordering scores, in score[], decide which of them
+ * are reduced, as in alphabeta().  The node's alpha, best score, best move and PV are
+ * updated in place.
+ */
+static void split(SearchThread *t, Player p, int ply, int d, int pvnode, Move *list, int *score,
+                  int n, int *alpha, int beta, int *best, Move *bestm) {
+    SplitPoint sp;
+    sp.parent = t->sp;
+    for (int i = 0; i < ply; i++)
+        sp.path[i] = t->made[i].m;
+    sp.p = p;
+    sp.ply = ply;
+    sp.d = d;
+    sp.pvnode = pvnode;
+    sp.beta = beta;
+    sp.list = list;
+    sp.score = score;
+    sp.nmoves = n;
+    sp.nextmove = 1;
+    sp.alpha = *alpha;
+    sp.best = *best;
+    sp.bestm = *bestm;
+    sp.pvlen = -1;
+    sp.workers = 0;
+    sp.cutoff = 0;
+
+    pthread_mutex_lock(&pool_lock);
+    sp.next = open_splits;
+    open_splits = &sp;
+    pthread_cond_broadcast(&pool_cond);
+    sp_search(t, &sp);
+    while (sp.workers)
+        pthread_cond_wait(&pool_cond, &pool_lock);
+    SplitPoint **spp = &open_splits;
+    while (*spp != &sp)
+        spp = &(*spp)->next;
+    *spp = sp.next;
+    pthread_mutex_unlock(&pool_lock);
+
+    *alpha = sp.alpha;
+    *best = sp.best;
+    *bestm = sp.bestm;
+    if (sp.pvlen >= 0) {
+        memcpy(t->pvtab[ply], sp.pv, sp.pvlen * sizeof(Move));
+        t->pvlen[ply] = sp.pvlen;
+    }
+}
+
+/*
+ * The open split point an idle thread should join: the one nearest the root
+ * (so the most work per move taken) that still has moves to hand out.  None
+ * once the search is stopped: the moves left would never be taken, and a
+ * thread joining and leaving over and over could keep the owner waiting.
+ * Called with pool_lock held.
+ */
+static SplitPoint *find_split(void) {
+    SplitPoint *found = NULL;
+    if (__atomic_load_n(&search_stop, __ATOMIC_RELAXED))
+        return NULL;
+    for (SplitPoint *sp = open_splits; sp; sp = sp->next) {
+        if (sp->nextmove >= sp->nmoves || (found && found->ply <= sp->ply))
+            continue;
+        SplitPoint *a = sp;
+        while (a && !a->cutoff)
+            a = a->parent;
+        if (!a) found = sp;
+    }
+    return found;
+}
+
+/*
+ * Bring a pool thread's board to a split point's node, by taking back its
+ * moves down to the last position the two paths from the root share and
+ * making the split point's moves from there.
+ */
+static void goto_split(SearchThread *t, SplitPoint *sp) {
+    int common = 0;
+    while (common < t->height && common < sp->ply && t->made[common].m == sp->path[common])
+        common++;
+    while (t->height > common)
+        unmake(t);
+    while (t->height < sp->ply)
+        make(t, sp->path[t->height]);
+}
+
+static void *pool_worker(void *arg) {
+    SearchThread *t = arg;
+    pthread_mutex_lock(&pool_lock);
+    for (;;) {
+        SplitPoint *sp = NULL;
+        while (!pool_quit && !(sp = find_split()))
+            pthread_cond_wait(&pool_cond, &pool_lock);
+        if (pool_quit)
+            break;
+        sp->workers++;
+        pthread_mutex_unlock(&pool_lock);
+        goto_split(t, sp);                /* sp stays open while it has workers */
+        pthread_mutex_lock(&pool_lock);
+        t->prevlen = 0;
+        sp_search(t, sp);
+        if (--sp->workers == 0)
+            pthread_cond_broadcast(&pool_cond);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return NULL;
+}
+
+static void pool_stop(void) {
+    pthread_mutex_lock(&pool_lock);
+    pool_quit = 1;
+    pthread_cond_broadcast(&pool_cond);
+    pthread_mutex_unlock(&pool_lock);
+    for (int i = 0; i < pool_size; i++)
+        pthread_join(pool_tids[i], NULL);
+    pool_size = 0;
+    pool_quit = 0;
+}
+
+static void pool_start(int n) {
+    for (pool_size = 0; pool_size < n; pool_size++) {
+        SearchThread *w = thread(pool_size + 1);
+        w->sp = NULL;
+        if (pthread_create(&pool_tids[pool_size], NULL, pool_worker, w) != 0)
+            break;
+    }
+}
+
+/*
+ * Exact score of a race position, when both players have only to bring their
+ * pieces home and the tablebase knows how many moves each needs.  The side to
+ * move gets home first if it needs no more moves than the other side.
+ */
+static int race_score(SearchThread *t, Player p, int ply, int *s) {
+    int mine = egtb_distance(t->bp, p), theirs;
+    if (mine <= 0 || (theirs = egtb_distance(t->bp, 1 - p)) <= 0)
+        return 0;
+    t->tbhits++;
+    *s = mine <= theirs ? WINEVAL - (ply + 2 * mine - 1) : -WINEVAL + ply + 2 * theirs;
+    return 1;
+}
+
+/*
+ * Quiescence search below the depth cutoff.  A multi-hop jump can swing the
+ * evaluation by several hundred, so a position in which one is available is
+ * not quiet.  Follow forward jumps only, for up to quiesce_ply more ply, and
+ * let the side to move stand pat on the static evaluation instead (it always
+ * has a step or a jump that does not lose ground).
+ */
+static int quiesce(SearchThread *t, Player p, int ply, int qply, int alpha, int beta) {
+    t->nodes++;
+    if (aborted(t))
+        return 0;
+
+    int e = eval_node(t, p);
+    if (e >= WINEVAL) return WINEVAL - ply;
+    if (e <= -WINEVAL) return -WINEVAL + ply;
+    if (race_score(t, p, ply, &e))
+        return e;
+    if (e >= beta || qply >= quiesce_ply)
+        return e;
+    if (e > alpha) alpha = e;
+
+    Move *list = t->moves[ply];
+    int *score = t->scores[ply];
+    int n = generate_jumps(t->bp, list, &t->repeathops), nf = 0;
+    for (int i = 0; i < n; i++) {
+        int f = p == X ? progress(list[i]) : -progress(list[i]);
+        if (f > 0) {
+            list[nf] = list[i];
+            score[nf++] = f;
+        }
+    }
+
+    int best = e;
+    for (int i = 0; i < nf; i++) {
+        pick_move(list, score, i, nf);
+        make(t, list[i]);
+        int s = -quiesce(t, 1 - p, ply + 1, qply + 1, -beta, -alpha);
+        unmake(t);
+        if (aborted(t))
+            return 0;
+        if (s > best) {
+            best = s;
+            if (s > alpha) alpha = s;
+            if (s >= beta) break;
+        }
+    }
+    return best;
+}
+
+static int alphabeta(SearchThread *t, Player p, int ply, int d, int onpv, int alpha, int beta) {
+    t->pvlen[ply] = 0;
+    if (d <= 0)
+        return quiesce(t, p, ply, 0, alpha, beta);
+    t->nodes++;
+    if (aborted(t))
+        return 0;
+
+    int e = eval_node(t, p);
+    if (e >= WINEVAL) return WINEVAL - ply;
+    if (e <= -WINEVAL) return -WINEVAL + ply;
+    if (ply > 0 && race_score(t, p, ply, &e))
+        return e;
+
+    int pvnode = beta > alpha + 1;
+    Move hashmove = 0;
+    TTEntry te;
+    if (tt_probe(t->key, &te)) {
+        hashmove = te.move;
+        if (ply > 0 && te.depth >= d) {
+            int s = score_from_tt(te.score, ply);
+            if (te.bound == TT_EXACT
+                || (te.bound == TT_LOWER && s >= beta)
+                || (te.bound == TT_UPPER && s <= alpha))
+                return s;
+        }
+    }
+
+    onpv = onpv && ply < t->prevlen;
+    if (onpv) hashmove = t->prevpv[ply];
+
+    Move *list = t->moves[ply];
+    int *score = t->scores[ply];
+    int n = generate_moves(t->bp, list, &t->repeathops);
+    if (n == 0) return e;
+    score_moves(t, p, ply, hashmove, list, score, n);
+
+    int alpha0 = alpha;
+    int best = -MAXEVAL;
+    Move bestm = 0;
+    int rnd = ply == 0 && randomized && t->id == 0;
+    for (int i = 0; i < n; i++) {
+        /* Young brothers wait for the eldest, then may be searched in parallel. */
+        if (i == 1 && pool_size && !rnd && d >= SPLIT_MIN_DEPTH) {
+            for (int j = 1; j < n; j++)
+                pick_move(list, score, j, n);
+            split(t, p, ply, d, pvnode, list, score, n, &alpha, beta, &best, &bestm);
+            if (aborted(t))
+                return 0;
+            break;
+        }
+        pick_move(list, score, i, n);
+        Move m = list[i];
+        /* With randomized play, widen the root window by one so that ties are exact. */
+        int a = rnd ? alpha - 1 : alpha;
+        int s;
+        make(t, m);
+        if (i == 0 || rnd) {
+            s = -alphabeta(t, 1 - p, ply + 1, d - 1, onpv && m == hashmove, -beta, -a);
+        } else {
+            s = search_later(t, p, ply, d, reduction(pvnode, d, i, score[i]), alpha, beta);
+        }
+        unmake(t);
+        if (aborted(t))
+            return 0;
+
+        if (s > best || (rnd && s == best && (rand() & 0x100))) {
+            best = s;
+            bestm = m;
+            if (s > alpha || ply == 0) {
+                t->pvtab[ply][0] = m;
+                memcpy(&t->pvtab[ply][1], t->pvtab[ply + 1], t->pvlen[ply + 1] * sizeof(Move));
+                t->pvlen[ply] = t->pvlen[ply + 1] + 1;
+            }
+            if (s > alpha) alpha = s;
+            if (s >= beta) {
+                t->cutoffs++;
+                if (i == 0) t->firstcutoffs++;
+                note_cutoff(t, p, ply, d, m);
+                break;
+            }
+        }
+    }
+
+    int bound = best >= beta ? TT_LOWER : best > alpha0 ? TT_EXACT : TT_UPPER;
+    tt_store(t->key, d, bound, score_to_tt(best, ply), bestm);
+    return best;
+}
+
+static void *helper(void *arg) {
+    SearchThread *t = arg;
+    alphabeta(t, t->bp->player, 0, t->depth, 1, -MAXEVAL, MAXEVAL);
+    return NULL;
+}
+
+int search(Board *bp, Player p, Move pv[], int alpha, int beta) {
+    static Board *roomy;                  // Copy of a board whose history lacks room for the search
+    SearchThread *t = &threads[0];
+    if (bp->nhist + STACK_PLY > MAXHIST) {
+        if (!roomy) roomy = newbd();
+        bp = copybd(bp, roomy);
+        make_history_room(bp, STACK_PLY);
+    }
+    t->bp = bp;
+    t->key = search_key;
+    eval_reset(t);
+    t->height = 0;
+    t->depth = depth;
+    clear_counts(t);
+    age_history(t);
+    t->sp = NULL;
+    for (t->prevlen = 0; t->prevlen < depth - 1 && pv[t->prevlen]; t->prevlen++)
+        t->prevpv[t->prevlen] = pv[t->prevlen];
+
+    /* The pool idles between searches; it is (re)started when the thread count changes. */
+    int nworkers = search_driver == SEARCH_YBWC ? search_threads - 1 : 0;
+    if (pool_size != nworkers) {
+        pool_stop();
+        pool_start(nworkers);
+    }
+    for (int i = 1; i <= pool_size; i++) {
+        set_root(&threads[i], t);
+        clear_counts(&threads[i]);
+        age_history(&threads[i]);
+    }
+
+    /* Odd-numbered helpers search one ply deeper than the main thread. */
+    pthread_t tids[MAXTHREADS];
+    int nhelpers = 0;
+    stop_helpers = 0;
+    for (int i = 1; i < search_threads && search_driver == SEARCH_LAZY; i++) {
+        SearchThread *h = thread(i);
+        h->sp = NULL;
+        set_root(h, t);
+        h->depth = depth + (i & 1) > MAXPLY ? MAXPLY : depth + (i & 1);
+        clear_counts(h);
+        age_history(h);
+        h->prevlen = t->prevlen;
+        memcpy(h->prevpv, t->prevpv, sizeof(h->prevpv));
+        if (pthread_create(&tids[nhelpers], NULL, helper, h) != 0)
+            break;
+        nhelpers++;
+    }
+
+    int s = alphabeta(t, p, 0, depth, 1, alpha, beta);
+
+    __atomic_store_n(&stop_helpers, 1, __ATOMIC_RELAXED);
+    for (int i = 0; i < nhelpers; i++) {
+        pthread_join(tids[i], NULL);
+        add_counts(t, &threads[i + 1]);
+    }
+    pthread_mutex_lock(&pool_lock);
+    for (int i = 1; i <= pool_size; i++)
+        add_counts(t, &threads[i]);
+    pthread_mutex_unlock(&pool_lock);
+    nodes += t->nodes;
+    total_cutoffs += t->cutoffs;
+    total_firstcutoffs += t->firstcutoffs;
+    total_tbhits += t->tbhits;
+    total_repeathops += t->repeathops;
+
+    /* Transposition cutoffs leave the PV short; complete it from the table. */
+    uint64_t key = search_key;
+    int n = 0;
+    for (; n < t->pvlen[0]; n++) {
+        pv[n] = t->pvtab[0][n];
+        key ^= tt_move_key(bp, pv[n]);
+        apply(bp, pv[n]);
+    }
+    for (; n < depth; n++) {
+        TTEntry te;
+        if (!tt_probe(key, &te) || !te.move || !is_legal(bp, te.move))
+            break;
+        pv[n] = te.move;
+        key ^= tt_move_key(bp, pv[n]);
+        apply(bp, pv[n]);
+    }
+    for (int i = n - 1; i >= 0; i--)
+        undo(bp);
+    for (; n < depth; n++)
+        pv[n] = 0;
+    return s;
+}
+
+int search_aspiration(Board *bp, Player p, Move pv[], int guess) {
+    if (guess <= -MAXEVAL || guess >= MAXEVAL
+        || guess >= MINWIN || guess <= -MINWIN)
+        return search(bp, p, pv, -MAXEVAL, MAXEVAL);
+
+    int delta = ASPIRATION_WINDOW;
+    int alpha = guess - delta, beta = guess + delta;
+    for (;;) {
+        int s = search(bp, p, pv, alpha, beta);
+        if (__atomic_load_n(&search_stop, __ATOMIC_RELAXED))
+            return s;
+        if (s > alpha && s < beta)
+            return s;
+        /* Widen the window on the side that failed, around the bound found. */
+        total_researches++;
+        delta *= 4;
+        if (s <= alpha)
+            alpha = s - delta < -MAXEVAL ? -MAXEVAL : s - delta;
+        else
+            beta = s + delta > MAXEVAL ? MAXEVAL : s + delta;
+        if (alpha == -MAXEVAL && beta == MAXEVAL)
+            return search(bp, p, pv, alpha, beta);
+    }
+}
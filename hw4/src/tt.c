@@ -0,0 +1,120 @@
+/*
+ * Transposition table and Zobrist keys.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "tt.h"
+
+int hash_mb = TT_DEFAULT_MB;
+
+typedef struct TTSlot {
+    uint64_t check;                       // key ^ data
+    uint64_t data;                        // Packed TTEntry
+} TTSlot;
+
+static TTSlot *table;
+static uint64_t tt_mask;                  // Number of entries - 1
+
+/* Keys indexed by player and cell (row << 4 | col, as in the move encoding). */
+static uint64_t zobrist[2][256];
+static uint64_t zside;
+
+/* splitmix64: fixed seed so that keys are the same from run to run. */
+static uint64_t next_key(uint64_t *s) {
+    uint64_t z = (*s += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void init_keys(void) {
+    uint64_t seed = 0x636368656b;
+    for (int p = 0; p < 2; p++)
+        for (int c = 0; c < 256; c++)
+            zobrist[p][c] = next_key(&seed);
+    zside = next_key(&seed);
+}
+
+int tt_init(int mb) {
+    init_keys();
+
+    if (mb < 1) mb = 1;
+    uint64_t n = 1;
+    while (n * 2 * sizeof(TTSlot) <= (uint64_t)mb << 20)
+        n *= 2;
+
+    free(table);
+    table = calloc(n, sizeof(TTSlot));
+    if (!table) {
+        tt_mask = 0;
+        return -1;
+    }
+    tt_mask = n - 1;
+    return 0;
+}
+
+void tt_clear(void) {
+    if (table)
+        memset(table, 0, (tt_mask + 1) * sizeof(TTSlot));
+}
+
+uint64_t tt_move_key(Board *bp, Move m) {
+    unsigned from = (m >> 8) & 0xff;
+    unsigned to = m & 0xff;
+    if (from == to)
+        return zside;
+    uint64_t k = zside ^ zobrist[bp->player][from] ^ zobrist[bp->player][to];
+    int v = CELL(bp, POS_ROW(to), POS_COL(to));
+    if (IS_PIECE(v))   /* swap with an opponent piece */
+        k ^= zobrist[PIECE_PLAYER(v)][from] ^ zobrist[PIECE_PLAYER(v)][to];
+    return k;
+}
+
+uint64_t tt_board_key(Board *bp) {
+    if (zside == 0)
+        init_keys();
+    uint64_t k = bp->player == O ? zside : 0;
+    for (int p = 0; p < 2; p++)
+        for (int i = 0; i < NPIECES; i++)
+            k ^= zobrist[p][bp->pos[p][i]];
+    return k;
+}
+
+/* Packed layout: score in bits 0-31, move in 32-48, depth in 49-56, bound in 57-58. */
+static uint64_t pack(int d, int bound, int score, Move m) {
+    return (uint32_t)score | (uint64_t)(m & 0x1ffff) << 32
+        | (uint64_t)(d & 0xff) << 49 | (uint64_t)bound << 57;
+}
+
+static int packed_depth(uint64_t data) {
+    return (data >> 49) & 0xff;
+}
+
+int tt_probe(uint64_t key, TTEntry *e) {
+    if (!table) return 0;
+    TTSlot *slot = &table[key & tt_mask];
+    uint64_t check = __atomic_load_n(&slot->check, __ATOMIC_RELAXED);
+    uint64_t data = __atomic_load_n(&slot->data, __ATOMIC_RELAXED);
+    if ((check ^ data) != key || packed_depth(data) == 0)
+        return 0;
+    e->score = (int32_t)(uint32_t)data;
+    e->move = (data >> 32) & 0x1ffff;
+    e->depth = packed_depth(data);
+    e->bound = (data >> 57) & 0x3;
+    return 1;
+}
+
+void tt_store(uint64_t key, int d, int bound, int score, Move m) {
+    if (!table) return;
+    TTSlot *slot = &table[key & tt_mask];
+    uint64_t check = __atomic_load_n(&slot->check, __ATOMIC_RELAXED);
+    uint64_t old = __atomic_load_n(&slot->data, __ATOMIC_RELAXED);
+    if ((check ^ old) == key && packed_depth(old) > d)
+        return;
+    uint64_t data = pack(d, bound, score, m);
+    __atomic_store_n(&slot->check, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->data, data, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,96 @@
+#include <criterion/criterion.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "movegen.h"
+#include "search.h"
+
+#define LONG_GAME 300                     // Ply played, well past MAXHIST
+
+/*
+ * A cycle of four moves that leaves the board as it was: a piece of each
+ * player steps out, then each steps back.  Repeating it makes a legal game
+ * of any length.
+ */
+static void step_cycle(Board *bp, Move cycle[4]) {
+    static Board *b;
+    if (!b) b = newbd();
+    copybd(bp, b);
+    Move list[MAXPOSMOVES];
+    for (int k = 0; k < 2; k++) {
+        int n = generate_moves(b, list, NULL), i;
+        for (i = 0; i < n; i++)
+            if (abs(row_to(list[i]) - row_from(list[i])) <= 1
+                && abs(col_to(list[i]) - col_from(list[i])) <= 1)
+                break;
+        cr_assert(i < n, "no single step for player %d", k);
+        cycle[k] = list[i];
+        apply(b, list[i]);
+    }
+    for (int k = 0; k < 2; k++) {
+        Move m = cycle[k];
+        cycle[k + 2] = (m & 0x10000) | ((m & 0xff) << 8) | ((m >> 8) & 0xff);
+    }
+}
+
+Test(history, make_room_keeps_last_moves) {
+    Board *bp = newbd(), *start = newbd();
+    Move cycle[4];
+    step_cycle(bp, cycle);
+    for (int i = 0; i < MAXHIST - 1; i++)
+        apply(bp, cycle[i % 4]);
+    copybd(bp, start);
+    make_history_room(bp, 5);
+    cr_assert_eq(bp->nhist, MAXHIST - 5);
+    cr_assert_eq(bp->history[bp->nhist - 1], cycle[(MAXHIST - 2) % 4]);
+    make_history_room(bp, 5);
+    cr_assert_eq(bp->nhist, MAXHIST - 5, "room already there: nothing dropped");
+
+    /* The moves still recorded can be taken back, and leave the cells as they were. */
+    for (int i = 0; i < 4; i++)
+        apply(bp, cycle[(MAXHIST - 1 + i) % 4]);
+    for (int i = 0; i < 4; i++)
+        undo(bp);
+    cr_assert(memcmp(bp->cell, start->cell, sizeof(bp->cell)) == 0);
+    cr_assert_eq(bp->player, start->player);
+}
+
+Test(history, search_past_maxhist) {
+    Board *bp = newbd(), *before = newbd();
+    Move cycle[4], pv[MAXPLY + 1];
+    step_cycle(bp, cycle);
+    search_init();
+    for (int ply = 0; ply < LONG_GAME; ply++) {
+        Move m = cycle[ply % 4];
+        search_apply(bp, m);
+        cr_assert(bp->nhist + STACK_PLY <= MAXHIST, "ply %d: no room for a search", ply);
+        cr_assert_eq(bp->history[bp->nhist - 1], m, "ply %d: last move lost", ply);
+
+        copybd(bp, before);
+        depth = 3;
+        memset(pv, 0, sizeof(pv));
+        search(bp, bp->player, pv, -MAXEVAL, MAXEVAL);
+        cr_assert(is_legal(bp, pv[0]), "ply %d: search returned an illegal move", ply);
+        cr_assert_eq(bp->nhist, before->nhist, "ply %d: search left moves on the board", ply);
+        cr_assert(memcmp(bp->cell, before->cell, sizeof(bp->cell)) == 0);
+    }
+}
+
+Test(history, search_on_full_history) {
+    Board *bp = newbd(), *before = newbd();
+    Move cycle[4], pv[MAXPLY + 1];
+    step_cycle(bp, cycle);
+    for (int i = 0; i < MAXHIST - 1; i++)
+        apply(bp, cycle[i % 4]);
+    copybd(bp, before);
+    search_init();
+    depth = MAXPLY;
+    search_node_limit = nodes + 200000;
+    memset(pv, 0, sizeof(pv));
+    search(bp, bp->player, pv, -MAXEVAL, MAXEVAL);
+    search_node_limit = 0;
+    search_stop = 0;
+    cr_assert_eq(bp->nhist, MAXHIST - 1, "the caller's board must not be trimmed");
+    cr_assert(memcmp(bp, before, sizeof(*bp)) == 0);
+}
@@ -0,0 +1,261 @@
+/*
+ * perft: count the leaves of the move tree to a fixed depth, to check move
+ * generators against each other and to time them apart from any search.
+ *
+ * A position where the game is over has no moves, so it is a leaf only at
+ * the full depth.  At the last ply the moves are counted, not made.
+ *
+ * Options:
+ *   -d <depth>   depth of the tree (default 4)
+ *   -i <file>    start from the position after the moves in a saved game score
+ *                (as for ccheck -i), instead of the initial position
+ *   -g <gen>     move generator: "board" (generate_moves(), the default),
+ *                "bits" (bb_generate_moves()) or "lib" (moves() in move.o, which
+ *                writes a global list and so allows only one thread)
+ *   -j <num>     number of threads, which share out the moves at the root
+ *   -H <MB>      hash subtree counts in a table of the given size (0: none, the default)
+ *   -v           print the count under each root move
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bitboard.h"
+#include "board.h"
+#include "ccheck.h"
+#include "clock.h"
+#include "movegen.h"
+#include "search.h"
+#include "tt.h"
+
+#define MAXTHREADS_PERFT 64
+
+enum { GEN_BOARD, GEN_BITS, GEN_LIB };
+static const char *gen_names[] = { "board", "bits", "lib" };
+
+/* Hashed subtree counts, under tt.c's keys; each slot holds the count and the key XORed with it. */
+typedef struct HashSlot {
+    uint64_t check;                       // key ^ count
+    uint64_t count;                       // Leaves below the position, at the depth in the key
+} HashSlot;
+
+static HashSlot *table;
+static uint64_t hash_mask;
+
+/*
+ * Per-thread state: a private copy of the root and the running key.  With
+ * the bitboard generator the board follows the moves only when counts are
+ * hashed, since the key is computed on it.
+ */
+typedef struct Worker {
+    pthread_t tid;
+    Board *bp;
+    BitPosition bits;
+    uint64_t key;
+    long nodes;                           // Interior nodes visited
+} Worker;
+
+static int gen = GEN_BOARD;
+static int nroot;                         // Number of root moves
+static Move rootmoves[MAXMOVES];
+static long rootcounts[MAXMOVES];
+static int nextroot;                      // Next root move to hand out (atomic)
+static int tree_depth = 4;
+
+static void die(const char *fmt, ...) __attribute__((format(printf, 1, 2), noreturn));
+static void die(const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "perft: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    exit(EXIT_FAILURE);
+}
+
+/* The key under which the count of a subtree d ply deep is hashed. */
+static uint64_t depth_key(uint64_t key, int d) {
+    return key ^ (0x9e3779b97f4a7c15ULL * (uint64_t)d);
+}
+
+static int probe(uint64_t key, long *count) {
+    HashSlot *s = &table[key & hash_mask];
+    uint64_t check = __atomic_load_n(&s->check, __ATOMIC_RELAXED);
+    uint64_t c = __atomic_load_n(&s->count, __ATOMIC_RELAXED);
+    if ((check ^ c) != key)
+        return 0;
+    *count = c;
+    return 1;
+}
+
+static void store(uint64_t key, long count) {
+    HashSlot *s = &table[key & hash_mask];
+    __atomic_store_n(&s->check, key ^ (uint64_t)count, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->count, (uint64_t)count, __ATOMIC_RELAXED);
+}
+
+static int over(Worker *w) {
+    return gen == GEN_BITS ? bb_game_over(&w->bits) : game_over(w->bp);
+}
+
+/* Generate the moves of the worker's position into list. */
+static int generate(Worker *w, Move *list) {
+    if (gen == GEN_BITS)
+        return bb_generate_moves(&w->bits, list);
+    if (gen == GEN_BOARD)
+        return generate_moves(w->bp, list, NULL);
+    moves(w->bp);
+    int n = resultp - resultlist;
+    memcpy(list, resultlist, n * sizeof(Move));
+    return n;
+}
+
+static void make(Worker *w, Move m) {
+    if (table)
+        w->key ^= tt_move_key(w->bp, m);
+    if (gen == GEN_BITS)
+        bb_apply(&w->bits, m);
+    if (gen != GEN_BITS || table)
+        apply(w->bp, m);
+}
+
+static void unmake(Worker *w, Move m) {
+    if (gen == GEN_BITS)
+        bb_undo(&w->bits, m);
+    if (gen != GEN_BITS || table) {
+        undo(w->bp);
+        if (table)
+            w->key ^= tt_move_key(w->bp, m);
+    }
+}
+
+static long perft(Worker *w, int d) {
+    if (over(w))
+        return 0;
+    long count;
+    uint64_t key = depth_key(w->key, d);
+    if (table && d > 1 && probe(key, &count))
+        return count;
+
+    Move list[MAXMOVES];                  /* the capacity of resultlist, for moves() */
+    int n = generate(w, list);
+    w->nodes++;
+    if (d == 1)
+        return n;
+    count = 0;
+    for (int i = 0; i < n; i++) {
+        make(w, list[i]);
+        count += perft(w, d - 1);
+        unmake(w, list[i]);
+    }
+    if (table)
+        store(key, count);
+    return count;
+}
+
+static void *worker(void *arg) {
+    Worker *w = arg;
+    int i;
+    while ((i = __atomic_fetch_add(&nextroot, 1, __ATOMIC_RELAXED)) < nroot) {
+        if (tree_depth == 1) {
+            rootcounts[i] = 1;
+            continue;
+        }
+        make(w, rootmoves[i]);
+        rootcounts[i] = perft(w, tree_depth - 1);
+        unmake(w, rootmoves[i]);
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    const char *init_file = NULL;
+    int nthreads = 1, mb = 0, verbose_counts = 0, opt;
+
+    while ((opt = getopt(argc, argv, ":d:i:g:j:H:v")) != -1) {
+        switch (opt) {
+            case 'd': tree_depth = atoi(optarg); break;
+            case 'i': init_file = optarg; break;
+            case 'g':
+                for (gen = 0; gen < 3 && strcmp(optarg, gen_names[gen]) != 0; gen++)
+                    continue;
+                if (gen == 3) die("unknown generator %s", optarg);
+                break;
+            case 'j': nthreads = atoi(optarg); break;
+            case 'H': mb = atoi(optarg); break;
+            case 'v': verbose_counts = 1; break;
+            case ':': die("missing argument for -%c", optopt);
+            default: die("unknown option -%c", optopt);
+        }
+    }
+    if (tree_depth < 1) die("depth must be at least 1");
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > MAXTHREADS_PERFT) nthreads = MAXTHREADS_PERFT;
+    if (gen == GEN_LIB) nthreads = 1;     /* moves() writes a global list */
+
+    Board *root = newbd();
+    if (init_file) {
+        FILE *f = fopen(init_file, "r");
+        if (!f) die("open -i %s: %s", init_file, strerror(errno));
+        Move m;
+        while ((m = read_move_from_pipe(f, root)) != 0) {
+            make_history_room(root, 1);
+            apply(root, m);
+        }
+        fclose(f);
+    }
+    if (tree_depth < MAXHIST)
+        make_history_room(root, tree_depth);
+    if (mb > 0) {
+        uint64_t n = 1;
+        while (n * 2 * sizeof(HashSlot) <= (uint64_t)mb << 20)
+            n *= 2;
+        table = calloc(n, sizeof(HashSlot));
+        if (!table) die("could not allocate %d MB hash table", mb);
+        hash_mask = n - 1;
+    }
+
+    Worker workers[MAXTHREADS_PERFT];
+    uint64_t rootkey = tt_board_key(root);
+    for (int i = 0; i < nthreads; i++) {
+        workers[i].bp = copybd(root, newbd());
+        bb_from_board(&workers[i].bits, root);
+        workers[i].key = rootkey;
+        workers[i].nodes = 0;
+    }
+    if (!game_over(root)) {
+        Move list[MAXMOVES];
+        nroot = generate(&workers[0], list);
+        memcpy(rootmoves, list, nroot * sizeof(Move));
+    }
+
+    int64_t start = clock_now();
+    for (int i = 1; i < nthreads; i++)
+        if (pthread_create(&workers[i].tid, NULL, worker, &workers[i]) != 0)
+            die("could not start thread %d", i);
+    worker(&workers[0]);
+    for (int i = 1; i < nthreads; i++)
+        pthread_join(workers[i].tid, NULL);
+    double secs = (double)(clock_now() - start) / USEC_PER_SEC;
+
+    long leaves = 0, nodes = nroot > 0;
+    for (int i = 0; i < nroot; i++) {
+        leaves += rootcounts[i];
+        if (verbose_counts) {
+            print_move(root, rootmoves[i], stdout);
+            printf(" %ld\n", rootcounts[i]);
+        }
+    }
+    for (int i = 0; i < nthreads; i++)
+        nodes += workers[i].nodes;
+    printf("depth %d, generator %s, %d thread%s, hash %s\n", tree_depth, gen_names[gen],
+           nthreads, nthreads > 1 ? "s" : "", table ? "on" : "off");
+    printf("leaves %ld, interior nodes %ld, %.3f s, %.2f Mleaves/s\n", leaves, nodes, secs,
+           secs > 0 ? leaves / secs / 1e6 : 0.0);
+    return EXIT_SUCCESS;
+}